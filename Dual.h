@@ -0,0 +1,151 @@
+/** Dual numbers for forward-mode differentiation
+ *
+ *           \class  Dual
+ *
+ *                   A value together with its derivatives with respect
+ *                   to DUAL_N parameters:\n
+ *                   \f[
+ *                   (a + a' \epsilon)(b + b' \epsilon) =
+ *                   ab + (a'b + ab') \epsilon
+ *                   \f]
+ *                   Running the controller equations on Dual instead
+ *                   of float carries \f$\partial / \partial f\f$,
+ *                   \f$\partial / \partial q\f$, learning rate and bias
+ *                   through one simulation.\n
+ *
+ *                   \b DUAL_F, \b DUAL_Q, \b DUAL_RATE, \b DUAL_BIAS
+ *                   are the indices of the derivatives.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef Dual_h_
+#define Dual_h_
+
+#include <math.h>
+
+#define DUAL_F    0
+#define DUAL_Q    1
+#define DUAL_RATE 2
+#define DUAL_BIAS 3
+
+#define DUAL_N 4
+
+// =====================================================================================
+// =====================================================================================
+struct Dual
+{
+    double v;
+    double d[DUAL_N];
+
+    Dual(double value=0.0) : v(value)
+    {
+        for (int i = 0; i < DUAL_N; i++) d[i] = 0.0;
+    }
+
+    /*! A parameter: derivative 1 with respect to itself */
+    static Dual seed(double value, int index)
+    {
+        Dual r(value);
+        r.d[index] = 1.0;
+        return r;
+    }
+
+    Dual& operator+=(const Dual& b)
+    {
+        v += b.v;
+        for (int i = 0; i < DUAL_N; i++) d[i] += b.d[i];
+        return *this;
+    }
+
+    Dual& operator-=(const Dual& b)
+    {
+        v -= b.v;
+        for (int i = 0; i < DUAL_N; i++) d[i] -= b.d[i];
+        return *this;
+    }
+
+    Dual& operator*=(const Dual& b)
+    {
+        for (int i = 0; i < DUAL_N; i++) d[i] = d[i] * b.v + v * b.d[i];
+        v *= b.v;
+        return *this;
+    }
+
+    Dual& operator/=(const Dual& b)
+    {
+        double inv = 1.0 / b.v;
+        for (int i = 0; i < DUAL_N; i++) d[i] = (d[i] - v * inv * b.d[i]) * inv;
+        v *= inv;
+        return *this;
+    }
+};
+
+inline Dual operator+(Dual a, const Dual& b) { return a += b; }
+inline Dual operator-(Dual a, const Dual& b) { return a -= b; }
+inline Dual operator*(Dual a, const Dual& b) { return a *= b; }
+inline Dual operator/(Dual a, const Dual& b) { return a /= b; }
+
+inline Dual operator-(const Dual& a)
+{
+    Dual r(-a.v);
+    for (int i = 0; i < DUAL_N; i++) r.d[i] = -a.d[i];
+    return r;
+}
+
+inline bool operator<(const Dual& a, const Dual& b) { return a.v < b.v; }
+inline bool operator>(const Dual& a, const Dual& b) { return a.v > b.v; }
+inline bool operator!=(const Dual& a, const Dual& b) { return a.v != b.v; }
+
+/*! f(a) with f'(a) = slope */
+inline Dual dual_chain(const Dual& a, double value, double slope)
+{
+    Dual r(value);
+    for (int i = 0; i < DUAL_N; i++) r.d[i] = slope * a.d[i];
+    return r;
+}
+
+inline Dual exp(const Dual& a)  { double e = ::exp(a.v); return dual_chain(a, e, e); }
+inline Dual sin(const Dual& a)  { return dual_chain(a, ::sin(a.v), ::cos(a.v)); }
+inline Dual cos(const Dual& a)  { return dual_chain(a, ::cos(a.v), -::sin(a.v)); }
+inline Dual sqrt(const Dual& a) { double s = ::sqrt(a.v); return dual_chain(a, s, 0.5 / s); }
+inline Dual fabs(const Dual& a) { return a.v < 0 ? -a : a; }
+
+// =====================================================================================
+// =====================================================================================
+
+/** A Dual with the value of a float
+ *
+ *              Every operation rounds the value to float, as the float
+ *              arithmetic of Uico does, so that UicoCore<DualF, Dual>
+ *              reproduces the values of UicoCore<float, double> bit
+ *              for bit (SSE builds). Dual plays the part of double:
+ *              the conversion from Dual rounds, the one to Dual is
+ *              exact. Mixed DualF/Dual expressions are ambiguous,
+ *              convert explicitly.
+ */
+struct DualF : Dual
+{
+    DualF(double value=0.0) : Dual((float)value) {}
+    DualF(const Dual& a) : Dual(a) { v = (float)v; }
+
+    DualF& operator+=(const DualF& b) { Dual::operator+=(b); v = (float)v; return *this; }
+    DualF& operator-=(const DualF& b) { Dual::operator-=(b); v = (float)v; return *this; }
+    DualF& operator*=(const DualF& b) { Dual::operator*=(b); v = (float)v; return *this; }
+    DualF& operator/=(const DualF& b) { Dual::operator/=(b); v = (float)v; return *this; }
+};
+
+inline DualF operator+(DualF a, const DualF& b) { return a += b; }
+inline DualF operator-(DualF a, const DualF& b) { return a -= b; }
+inline DualF operator*(DualF a, const DualF& b) { return a *= b; }
+inline DualF operator/(DualF a, const DualF& b) { return a /= b; }
+inline DualF operator-(const DualF& a) { return DualF(-(const Dual&)a); }
+
+inline DualF exp(const DualF& a)  { return DualF(exp((const Dual&)a)); }
+inline DualF cos(const DualF& a)  { return DualF(cos((const Dual&)a)); }
+inline DualF fabs(const DualF& a) { return DualF(fabs((const Dual&)a)); }
+
+#endif
@@ -0,0 +1,1067 @@
+/** Filter graphs imported from Simulink
+ *
+ *           \class  FilterGraph
+ *
+ *                   See FilterGraph.h. The .mdl text is a tree of
+ *                   "Name {" ... "}" sections holding "Key value" lines;
+ *                   only Model/BlockParameterDefaults and Model/System
+ *                   are used.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "FilterGraph.h"
+
+#include <stdlib.h>
+#include <map>
+#include <algorithm>
+
+// =====================================================================================
+// MDL text
+// =====================================================================================
+
+namespace
+{
+
+/*! One "Name { ... }" section of the model file */
+struct MdlSection
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string> > params;
+    std::vector<MdlSection> children;
+
+    const std::string* get(const std::string& key) const
+    {
+        for (size_t i = 0; i < params.size(); i++)
+            if (params[i].first == key)
+                return &params[i].second;
+        return 0;
+    }
+};
+
+std::string trim(const std::string& s)
+{
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+/*! The content of a "quoted \"string\"" with the escapes resolved */
+std::string unquote(const std::string& s)
+{
+    if (s.empty() || s[0] != '"')
+        return s;
+    std::string r;
+    for (size_t i = 1; i < s.size() && s[i] != '"'; i++)
+    {
+        if (s[i] == '\\' && i + 1 < s.size())
+        {
+            i++;
+            r += (s[i] == 'n') ? '\n' : (s[i] == 't') ? '\t' : s[i];
+        }
+        else
+            r += s[i];
+    }
+    return r;
+}
+
+void parseSection(const std::vector<std::string>& lines, size_t& i, MdlSection& node)
+{
+    while (i < lines.size())
+    {
+        std::string line = trim(lines[i++]);
+        if (line.empty())
+            continue;
+        if (line == "}")
+            return;
+
+        // long strings continue on the next lines as further "..."
+        if (line[0] == '"')
+        {
+            if (!node.params.empty())
+                node.params.back().second += unquote(line);
+            continue;
+        }
+
+        size_t sp = line.find_first_of(" \t");
+        std::string key = line.substr(0, sp);
+        std::string value = (sp == std::string::npos) ? "" : trim(line.substr(sp));
+
+        if (value == "{")
+        {
+            node.children.push_back(MdlSection());
+            node.children.back().name = key;
+            parseSection(lines, i, node.children.back());
+        }
+        else
+            node.params.push_back(std::make_pair(key, unquote(value)));
+    }
+}
+
+/** "[1 2; 3, 4]", "[-0.2;1]" or "0.5" into rows of numbers
+ *
+ *     @return  false if anything but a numeric literal is found
+ */
+bool parseMatrix(const std::string& text, std::vector<std::vector<double> >& rows)
+{
+    rows.clear();
+    std::string s = trim(text);
+    if (!s.empty() && s[0] == '[')
+    {
+        if (s[s.size() - 1] != ']')
+            return false;
+        s = s.substr(1, s.size() - 2);
+    }
+
+    rows.push_back(std::vector<double>());
+    const char* p = s.c_str();
+    while (*p)
+    {
+        if (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        else if (*p == ';')
+        {
+            rows.push_back(std::vector<double>());
+            p++;
+        }
+        else
+        {
+            char* end;
+            double v = strtod(p, &end);
+            if (end == p)
+                return false;
+            rows.back().push_back(v);
+            p = end;
+        }
+    }
+    if (rows.back().empty())
+        rows.pop_back();
+    return !rows.empty() && !rows[0].empty();
+}
+
+/*! All the values of a matrix, row after row */
+std::vector<double> flatten(const std::vector<std::vector<double> >& rows)
+{
+    std::vector<double> r;
+    for (size_t i = 0; i < rows.size(); i++)
+        r.insert(r.end(), rows[i].begin(), rows[i].end());
+    return r;
+}
+
+std::string printable(const std::string& name)
+{
+    std::string r = name;
+    std::replace(r.begin(), r.end(), '\n', ' ');
+    return r;
+}
+
+/*! A graph output: Outports first by port number, then the scopes */
+struct Sink
+{
+    int order;
+    int seq;
+    std::string name;
+    int producer;
+
+    bool operator<(const Sink& b) const
+    {
+        return order != b.order ? order < b.order : seq < b.seq;
+    }
+};
+
+#define SINK_SCOPE_ORDER 1000000
+
+/*! s[k] = b[k+1] x - a[k+1] y + s[k+1] of a transposed filter, zero taps dropped */
+void emitStates(FILE* f, int state, int order, int x, int y, const double* c)
+{
+    for (int k = 0; k < order; k++)
+    {
+        double b = c[k + 1], a = -c[order + 1 + k + 1];
+        bool any = false;
+        fprintf(f, "        s[%d] =", state + k);
+        if (b != 0.0)
+        {
+            fprintf(f, " %.17g * y%d", b, x);
+            any = true;
+        }
+        if (a != 0.0)
+        {
+            fprintf(f, any ? " %c %.17g * y%d" : " %c%.17g * y%d", a < 0 ? '-' : (any ? '+' : ' '), fabs(a), y);
+            any = true;
+        }
+        if (k + 1 < order)
+        {
+            fprintf(f, "%s s[%d]", any ? " +" : "", state + k + 1);
+            any = true;
+        }
+        fprintf(f, "%s;\n", any ? "" : " 0.0");
+    }
+}
+
+}
+
+// =====================================================================================
+// Constructor
+// =====================================================================================
+
+FilterGraph::FilterGraph()
+{
+    tick_ = 0;
+}
+
+bool FilterGraph::fail(const std::string& what)
+{
+    error_ = what;
+    nodes_.clear();
+    inputs_.clear();
+    outputs_.clear();
+    outputNames_.clear();
+    ops_.clear();
+    updates_.clear();
+    signal_.clear();
+    coef_.clear();
+    state_.clear();
+    args_.clear();
+    outSignal_.clear();
+    tick_ = 0;
+    return false;
+}
+
+// =====================================================================================
+// Import
+// =====================================================================================
+
+/** Import a Simulink model
+ *
+ *      @param  path const char* - The .mdl file
+ *     @return  false with getError() set on failure
+ */
+bool FilterGraph::load(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == 0)
+        return fail(std::string("cannot open ") + path);
+
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.append(buffer, n);
+    fclose(f);
+    return parse(text);
+}
+
+/** Lowering of the model
+ *
+ *              Every block becomes a chain of nodes: \b head takes the
+ *              block inputs, \b tail gives its output. The lines then
+ *              connect tails to heads or to the sinks.
+ *
+ *      @param  text std::string - The .mdl text
+ *     @return  false with getError() set on failure
+ */
+bool FilterGraph::parse(const std::string& text)
+{
+    fail("");
+
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+
+    MdlSection root;
+    size_t i = 0;
+    parseSection(lines, i, root);
+
+    const MdlSection* model = 0;
+    for (size_t k = 0; k < root.children.size() && !model; k++)
+        if (root.children[k].name == "Model" || root.children[k].name == "Library")
+            model = &root.children[k];
+    if (!model)
+        return fail("no Model section");
+
+    const MdlSection* system = 0;
+    std::map<std::string, const MdlSection*> defaults;
+    for (size_t k = 0; k < model->children.size(); k++)
+    {
+        const MdlSection& c = model->children[k];
+        if (c.name == "System" && !system)
+            system = &c;
+        if (c.name == "BlockParameterDefaults")
+            for (size_t b = 0; b < c.children.size(); b++)
+                if (const std::string* t = c.children[b].get("BlockType"))
+                    defaults[*t] = &c.children[b];
+    }
+    if (!system)
+        return fail("no System section");
+
+    // ------------------------------------------------------------------
+    // Blocks
+    // ------------------------------------------------------------------
+    std::map<std::string, int> head, tail;
+    std::map<std::string, int> sinkOrder;
+    std::map<std::string, int> blockSeq;
+    int seq = 0;
+
+    for (size_t k = 0; k < system->children.size(); k++)
+    {
+        const MdlSection& block = system->children[k];
+        if (block.name != "Block")
+            continue;
+
+        const std::string* typePtr = block.get("BlockType");
+        const std::string* namePtr = block.get("Name");
+        if (!typePtr || !namePtr)
+            return fail("block without BlockType or Name");
+        std::string type = *typePtr;
+        std::string name = *namePtr;
+        std::string label = printable(name);
+        blockSeq[name] = seq++;
+
+        const MdlSection* def = defaults.count(type) ? defaults[type] : 0;
+
+        // Parameter lookup: block, model defaults, Simulink defaults
+        #define PARAM(key, fallback) \
+            (block.get(key) ? *block.get(key) : (def && def->get(key)) ? *def->get(key) : std::string(fallback))
+
+        std::vector<std::vector<double> > m;
+        #define NUMERIC(key, fallback) \
+            if (!parseMatrix(PARAM(key, fallback), m)) \
+                return fail("parameter " key " of block '" + label + "' is not a numeric literal");
+
+        Node node;
+        node.name = label;
+        node.gain = 0.0;
+        node.port = 0;
+        node.period = node.width = node.phase = 0;
+        node.dead = false;
+
+        if (type == "Gain")
+        {
+            NUMERIC("Gain", "1");
+            if (m.size() != 1 || m[0].size() != 1)
+                return fail("gain of block '" + label + "' is not a scalar");
+            node.kind = OP_GAIN;
+            node.gain = m[0][0];
+            node.in.assign(1, -1);
+        }
+        else if (type == "Sum")
+        {
+            std::string signs = PARAM("Inputs", "++");
+            node.kind = OP_SUM;
+            int count = atoi(signs.c_str());
+            if (count > 0)
+                node.signs.assign(count, 1.0);
+            else
+                for (size_t c = 0; c < signs.size(); c++)
+                {
+                    if (signs[c] == '+') node.signs.push_back(1.0);
+                    else if (signs[c] == '-') node.signs.push_back(-1.0);
+                }
+            if (node.signs.empty())
+                return fail("no inputs on sum '" + label + "'");
+            node.in.assign(node.signs.size(), -1);
+        }
+        else if (type == "UnitDelay")
+        {
+            NUMERIC("X0", "0");
+            node.kind = OP_DELAY;
+            node.gain = m[0][0];
+            node.in.assign(1, -1);
+        }
+        else if (type == "Constant")
+        {
+            NUMERIC("Value", "1");
+            if (m.size() != 1 || m[0].size() != 1)
+                return fail("value of block '" + label + "' is not a scalar");
+            node.kind = OP_CONST;
+            node.gain = m[0][0];
+        }
+        else if (type == "DiscreteTransferFcn")
+        {
+            NUMERIC("Numerator", "[1]");
+            node.num = flatten(m);
+            NUMERIC("Denominator", "[1 0.5]");
+            node.den = flatten(m);
+            // Descending powers of z: a shorter numerator is delayed
+            if (node.num.size() > node.den.size())
+                return fail("transfer function '" + label + "' is improper");
+            node.num.insert(node.num.begin(), node.den.size() - node.num.size(), 0.0);
+            node.kind = OP_IIR;
+            node.in.assign(1, -1);
+        }
+        else if (type == "DiscretePulseGenerator")
+        {
+            if (PARAM("PulseType", "Sample based") != "Sample based")
+                return fail("pulse generator '" + label + "' is not sample based");
+            node.kind = OP_PULSE;
+            NUMERIC("Amplitude", "1");
+            node.gain = m[0][0];
+            NUMERIC("Period", "2");
+            node.period = (int)m[0][0];
+            NUMERIC("PulseWidth", "1");
+            node.width = (int)m[0][0];
+            NUMERIC("PhaseDelay", "0");
+            node.phase = (int)m[0][0];
+            if (node.period < 1)
+                return fail("period of pulse generator '" + label + "' must be positive");
+        }
+        else if (type == "Inport")
+        {
+            NUMERIC("Port", "1");
+            node.kind = OP_INPUT;
+            node.port = (int)m[0][0] - 1;
+        }
+        else if (type == "Outport")
+        {
+            NUMERIC("Port", "1");
+            sinkOrder[name] = (int)m[0][0];
+            continue;
+        }
+        else if (type == "Scope" || type == "Display" || type == "ToWorkspace")
+        {
+            sinkOrder[name] = SINK_SCOPE_ORDER;
+            continue;
+        }
+        else if (type == "Reference" && PARAM("SourceType", "") == "Digital Filter")
+        {
+            if (PARAM("CoeffSource", "Specify via dialog") != "Specify via dialog")
+                return fail("coefficients of '" + label + "' are not given in the dialog");
+
+            std::string filter = PARAM("TypePopup", "IIR (poles & zeros)");
+            node.kind = OP_IIR;
+            node.in.assign(1, -1);
+
+            if (filter == "FIR (all zeros)")
+            {
+                NUMERIC("NumCoeffs", "[1]");
+                node.num = flatten(m);
+                node.den.assign(1, 1.0);
+            }
+            else if (filter == "IIR (all poles)")
+            {
+                NUMERIC("DenCoeffs", "[1]");
+                node.den = flatten(m);
+                node.num.assign(1, 1.0);
+            }
+            else if (filter == "IIR (poles & zeros)"
+                     && PARAM("IIRFiltStruct", "").find("SOS") != std::string::npos)
+            {
+                // Cascade: scale[0], section 1, scale[1], section 2 ...
+                std::vector<std::vector<double> > sos;
+                NUMERIC("BiQuadCoeffs", "[1 0 0 1 0 0]");
+                sos = m;
+                NUMERIC("ScaleValues", "1");
+                std::vector<double> scale = flatten(m);
+                scale.resize(sos.size() + 1, 1.0);
+
+                int prev = -1;
+                for (size_t s = 0; s <= sos.size(); s++)
+                {
+                    if (scale[s] != 1.0)
+                    {
+                        Node g = node;
+                        g.kind = OP_GAIN;
+                        g.gain = scale[s];
+                        g.num.clear();
+                        g.den.clear();
+                        g.in.assign(1, prev);
+                        nodes_.push_back(g);
+                        if (prev < 0) head[name] = (int)nodes_.size() - 1;
+                        prev = (int)nodes_.size() - 1;
+                    }
+                    if (s == sos.size())
+                        break;
+                    if (sos[s].size() != 6)
+                        return fail("biquad of '" + label + "' needs 6 coefficients per row");
+                    Node section = node;
+                    section.num.assign(sos[s].begin(), sos[s].begin() + 3);
+                    section.den.assign(sos[s].begin() + 3, sos[s].end());
+                    if (section.den[0] == 0.0)
+                        return fail("leading denominator coefficient of '" + label + "' is zero");
+                    for (int c = 5; c >= 0; c--)
+                        (c < 3 ? section.num[c] : section.den[c - 3]) /= sos[s][3];
+                    section.in.assign(1, prev);
+                    nodes_.push_back(section);
+                    if (prev < 0) head[name] = (int)nodes_.size() - 1;
+                    prev = (int)nodes_.size() - 1;
+                }
+                tail[name] = prev;
+                continue;
+            }
+            else if (filter == "IIR (poles & zeros)")
+            {
+                NUMERIC("NumCoeffs", "[1]");
+                node.num = flatten(m);
+                NUMERIC("DenCoeffs", "[1]");
+                node.den = flatten(m);
+            }
+            else
+                return fail("filter type '" + filter + "' of '" + label + "' is not supported");
+
+            // Ascending powers of z^-1: pad at the end
+            size_t len = std::max(node.num.size(), node.den.size());
+            node.num.resize(len, 0.0);
+            node.den.resize(len, 0.0);
+        }
+        else
+            return fail("block type " + type + " ('" + label + "') is not supported");
+
+        #undef NUMERIC
+        #undef PARAM
+
+        if (node.kind == OP_IIR)
+        {
+            if (node.den.empty() || node.den[0] == 0.0)
+                return fail("leading denominator coefficient of '" + label + "' is zero");
+            double a0 = node.den[0];
+            for (size_t c = 0; c < node.num.size(); c++) node.num[c] /= a0;
+            for (size_t c = 0; c < node.den.size(); c++) node.den[c] /= a0;
+        }
+
+        nodes_.push_back(node);
+        head[name] = tail[name] = (int)nodes_.size() - 1;
+    }
+
+    // ------------------------------------------------------------------
+    // Lines
+    // ------------------------------------------------------------------
+    std::vector<Sink> sinks;
+    for (size_t k = 0; k < system->children.size(); k++)
+    {
+        const MdlSection& line = system->children[k];
+        if (line.name != "Line")
+            continue;
+
+        const std::string* src = line.get("SrcBlock");
+        if (!src || !tail.count(*src))
+            return fail("line from an unknown block");
+        if (line.get("SrcPort") && atoi(line.get("SrcPort")->c_str()) != 1)
+            return fail("block '" + printable(*src) + "' has more than one output");
+        int producer = tail[*src];
+
+        // the line itself and its branches, depth first
+        std::vector<const MdlSection*> todo(1, &line);
+        while (!todo.empty())
+        {
+            const MdlSection* part = todo.back();
+            todo.pop_back();
+            for (size_t b = 0; b < part->children.size(); b++)
+                if (part->children[b].name == "Branch")
+                    todo.push_back(&part->children[b]);
+
+            const std::string* dst = part->get("DstBlock");
+            if (!dst)
+                continue;
+            int port = part->get("DstPort") ? atoi(part->get("DstPort")->c_str()) : 1;
+
+            if (sinkOrder.count(*dst))
+            {
+                Sink sink;
+                sink.order = sinkOrder[*dst];
+                sink.seq = blockSeq[*dst] * 64 + port;
+                sink.name = printable(*dst);
+                if (sink.order == SINK_SCOPE_ORDER && port > 1)
+                {
+                    char suffix[16];
+                    sprintf(suffix, ":%d", port);
+                    sink.name += suffix;
+                }
+                sink.producer = producer;
+                sinks.push_back(sink);
+            }
+            else if (head.count(*dst))
+            {
+                Node& n = nodes_[head[*dst]];
+                if (port < 1 || port > (int)n.in.size())
+                    return fail("block '" + printable(*dst) + "' has no such input port");
+                n.in[port - 1] = producer;
+            }
+            else
+                return fail("line to an unknown block '" + printable(*dst) + "'");
+        }
+    }
+
+    for (size_t k = 0; k < nodes_.size(); k++)
+        for (size_t p = 0; p < nodes_[k].in.size(); p++)
+            if (nodes_[k].in[p] < 0)
+                return fail("an input of '" + nodes_[k].name + "' is not connected");
+
+    std::stable_sort(sinks.begin(), sinks.end());
+    for (size_t k = 0; k < sinks.size(); k++)
+    {
+        outputs_.push_back(sinks[k].producer);
+        outputNames_.push_back(sinks[k].name);
+    }
+
+    // Inports are numbered 1..n without gaps, as Simulink requires
+    for (size_t k = 0; k < nodes_.size(); k++)
+        if (nodes_[k].kind == OP_INPUT)
+        {
+            int port = nodes_[k].port;
+            if (port < 0)
+                return fail("port of inport '" + nodes_[k].name + "' must be positive");
+            if ((int)inputs_.size() <= port)
+                inputs_.resize(port + 1, -1);
+            if (inputs_[port] >= 0)
+                return fail("inports '" + nodes_[inputs_[port]].name + "' and '" + nodes_[k].name + "' share a port");
+            inputs_[port] = (int)k;
+        }
+    for (size_t p = 0; p < inputs_.size(); p++)
+        if (inputs_[p] < 0)
+        {
+            char number[16];
+            sprintf(number, "%d", (int)p + 1);
+            return fail(std::string("no inport with port ") + number);
+        }
+
+    fuse();
+    if (!schedule())
+        return false;
+    compile();
+    return true;
+}
+
+// =====================================================================================
+// Lowering passes
+// =====================================================================================
+
+/** Folding of the gains into the filters
+ *
+ *              A gain whose only producer is a filter (or gain) used
+ *              nowhere else is moved into that numerator, and a gain
+ *              whose only consumer is a filter is moved into that
+ *              numerator. This removes the scale values of the SOS
+ *              cascades.
+ */
+void FilterGraph::fuse()
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        std::vector<int> uses(nodes_.size(), 0);
+        std::vector<int> consumer(nodes_.size(), -1);
+        for (size_t k = 0; k < nodes_.size(); k++)
+        {
+            if (nodes_[k].dead)
+                continue;
+            for (size_t p = 0; p < nodes_[k].in.size(); p++)
+            {
+                uses[nodes_[k].in[p]]++;
+                consumer[nodes_[k].in[p]] = (int)k;
+            }
+        }
+        for (size_t k = 0; k < outputs_.size(); k++)
+            uses[outputs_[k]] += 2;
+
+        for (size_t g = 0; g < nodes_.size() && !changed; g++)
+        {
+            Node& gain = nodes_[g];
+            if (gain.dead || gain.kind != OP_GAIN)
+                continue;
+
+            int p = gain.in[0];
+            Node& producer = nodes_[p];
+            int c = consumer[g];
+
+            if (uses[p] == 1 && (producer.kind == OP_IIR || producer.kind == OP_GAIN))
+            {
+                if (producer.kind == OP_GAIN)
+                    producer.gain *= gain.gain;
+                else
+                    for (size_t i = 0; i < producer.num.size(); i++)
+                        producer.num[i] *= gain.gain;
+
+                for (size_t k = 0; k < nodes_.size(); k++)
+                    for (size_t i = 0; i < nodes_[k].in.size(); i++)
+                        if (nodes_[k].in[i] == (int)g)
+                            nodes_[k].in[i] = p;
+                for (size_t k = 0; k < outputs_.size(); k++)
+                    if (outputs_[k] == (int)g)
+                        outputs_[k] = p;
+                gain.dead = true;
+                changed = true;
+            }
+            else if (uses[g] == 1 && c >= 0 && nodes_[c].kind == OP_IIR)
+            {
+                Node& filter = nodes_[c];
+                for (size_t i = 0; i < filter.num.size(); i++)
+                    filter.num[i] *= gain.gain;
+                filter.in[0] = p;
+                gain.dead = true;
+                changed = true;
+            }
+        }
+    }
+}
+
+/*! True if the output of the node depends on its input of the same tick */
+bool FilterGraph::feedthrough(const Node& n)
+{
+    if (n.kind == OP_DELAY)
+        return false;
+    // an order 0 filter is a gain, even with a zero numerator
+    if (n.kind == OP_IIR)
+        return n.num.size() == 1 || n.num[0] != 0.0;
+    return true;
+}
+
+/** Topological order of the output phase
+ *
+ *     @return  false if the graph has an algebraic loop
+ */
+bool FilterGraph::schedule()
+{
+    size_t count = nodes_.size();
+    std::vector<int> pending(count, 0);
+    std::vector<std::vector<int> > users(count);
+    std::vector<int> ready;
+    size_t live = 0;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        if (nodes_[k].dead)
+            continue;
+        live++;
+        if (feedthrough(nodes_[k]))
+            for (size_t p = 0; p < nodes_[k].in.size(); p++)
+            {
+                users[nodes_[k].in[p]].push_back((int)k);
+                pending[k]++;
+            }
+        if (pending[k] == 0)
+            ready.push_back((int)k);
+    }
+
+    ops_.clear();
+    updates_.clear();
+    for (size_t r = 0; r < ready.size(); r++)
+    {
+        int k = ready[r];
+        Op op;
+        op.kind = nodes_[k].kind;
+        op.node = k;
+        ops_.push_back(op);
+        if (!feedthrough(nodes_[k]))
+            updates_.push_back(op);
+
+        for (size_t u = 0; u < users[k].size(); u++)
+            if (--pending[users[k][u]] == 0)
+                ready.push_back(users[k][u]);
+    }
+
+    if (ops_.size() != live)
+    {
+        for (size_t k = 0; k < count; k++)
+            if (!nodes_[k].dead && pending[k] > 0)
+                return fail("algebraic loop through '" + nodes_[k].name + "'");
+    }
+    return true;
+}
+
+/** Allocation of the flat buffers
+ *
+ *              Signal k is the output of node k; coefficients and
+ *              states of all the ops are packed in coef_ and state_.
+ */
+void FilterGraph::compile()
+{
+    signal_.assign(nodes_.size(), 0.0);
+    coef_.clear();
+    args_.clear();
+    int states = 0;
+
+    for (size_t i = 0; i < ops_.size(); i++)
+    {
+        Op& op = ops_[i];
+        const Node& n = nodes_[op.node];
+        op.out = op.node;
+        op.in = n.in.empty() ? -1 : n.in[0];
+        op.count = 0;
+        op.coef = (int)coef_.size();
+        op.state = states;
+
+        switch (n.kind)
+        {
+        case OP_INPUT:
+            op.in = n.port;
+            break;
+        case OP_CONST:
+        case OP_GAIN:
+            coef_.push_back(n.gain);
+            break;
+        case OP_PULSE:
+            coef_.push_back(n.gain);
+            coef_.push_back(n.period);
+            coef_.push_back(n.width);
+            coef_.push_back(n.phase);
+            break;
+        case OP_SUM:
+            op.in = (int)args_.size();
+            op.count = (int)n.in.size();
+            args_.insert(args_.end(), n.in.begin(), n.in.end());
+            coef_.insert(coef_.end(), n.signs.begin(), n.signs.end());
+            break;
+        case OP_DELAY:
+            coef_.push_back(n.gain);
+            states += 1;
+            break;
+        case OP_IIR:
+            op.count = (int)n.num.size() - 1;
+            coef_.insert(coef_.end(), n.num.begin(), n.num.end());
+            coef_.insert(coef_.end(), n.den.begin(), n.den.end());
+            states += op.count;
+            break;
+        }
+    }
+
+    // the update phase refers to the same slots
+    for (size_t u = 0; u < updates_.size(); u++)
+        for (size_t i = 0; i < ops_.size(); i++)
+            if (ops_[i].node == updates_[u].node)
+                updates_[u] = ops_[i];
+
+    state_.assign(states, 0.0);
+    outSignal_ = outputs_;
+    reset();
+}
+
+// =====================================================================================
+// Executor
+// =====================================================================================
+
+void FilterGraph::reset()
+{
+    std::fill(state_.begin(), state_.end(), 0.0);
+    for (size_t i = 0; i < ops_.size(); i++)
+        if (ops_[i].kind == OP_DELAY)
+            state_[ops_[i].state] = coef_[ops_[i].coef];
+    tick_ = 0;
+}
+
+/** One tick
+ *
+ *              Output phase in topological order; feedthrough filters
+ *              update their state on the spot, delays and strictly
+ *              proper filters in the update phase at the end.
+ *
+ *      @param  in const double* - getInputCount() values (may be 0)
+ *      @param  out double* - getOutputCount() values
+ */
+void FilterGraph::step(const double* in, double* out)
+{
+    if (ops_.empty())
+        return;
+
+    double* y = &signal_[0];
+    const double* c = coef_.empty() ? 0 : &coef_[0];
+    double* s = state_.empty() ? 0 : &state_[0];
+
+    for (size_t i = 0; i < ops_.size(); i++)
+    {
+        const Op& op = ops_[i];
+        switch (op.kind)
+        {
+        case OP_INPUT:
+            y[op.out] = in ? in[op.in] : 0.0;
+            break;
+        case OP_CONST:
+            y[op.out] = c[op.coef];
+            break;
+        case OP_PULSE:
+        {
+            long k = tick_ - (long)c[op.coef + 3];
+            y[op.out] = (k >= 0 && k % (long)c[op.coef + 1] < (long)c[op.coef + 2]) ? c[op.coef] : 0.0;
+            break;
+        }
+        case OP_GAIN:
+            y[op.out] = c[op.coef] * y[op.in];
+            break;
+        case OP_SUM:
+        {
+            double acc = 0.0;
+            for (int k = 0; k < op.count; k++)
+                acc += c[op.coef + k] * y[args_[op.in + k]];
+            y[op.out] = acc;
+            break;
+        }
+        case OP_DELAY:
+            y[op.out] = s[op.state];
+            break;
+        case OP_IIR:
+        {
+            const double* b = c + op.coef;
+            const double* a = b + op.count + 1;
+            double* z = s + op.state;
+            int n = op.count;
+            if (n == 0)
+            {
+                y[op.out] = b[0] * y[op.in];
+                break;
+            }
+            if (b[0] == 0.0)
+            {
+                y[op.out] = z[0];
+                break;
+            }
+            double x = y[op.in];
+            double v = b[0] * x + z[0];
+            for (int k = 0; k < n - 1; k++)
+                z[k] = b[k + 1] * x - a[k + 1] * v + z[k + 1];
+            z[n - 1] = b[n] * x - a[n] * v;
+            y[op.out] = v;
+            break;
+        }
+        }
+    }
+
+    for (size_t i = 0; i < updates_.size(); i++)
+    {
+        const Op& op = updates_[i];
+        if (op.kind == OP_DELAY)
+            s[op.state] = y[op.in];
+        else
+        {
+            const double* b = c + op.coef;
+            const double* a = b + op.count + 1;
+            double* z = s + op.state;
+            int n = op.count;
+            double x = y[op.in];
+            double v = y[op.out];
+            if (n == 0)
+                continue;
+            for (int k = 0; k < n - 1; k++)
+                z[k] = b[k + 1] * x - a[k + 1] * v + z[k + 1];
+            z[n - 1] = b[n] * x - a[n] * v;
+        }
+    }
+
+    for (size_t k = 0; k < outSignal_.size(); k++)
+        out[k] = y[outSignal_[k]];
+    tick_++;
+}
+
+/*! n ticks, in and out are n rows of inputs and outputs */
+void FilterGraph::run(int n, const double* in, double* out)
+{
+    int ni = getInputCount();
+    int no = getOutputCount();
+    for (int k = 0; k < n; k++)
+        step(in ? in + k * ni : 0, out + k * no);
+}
+
+// =====================================================================================
+// Code generation
+// =====================================================================================
+
+/** Write the schedule as a C++ class
+ *
+ *              The class has the same step()/reset() interface as the
+ *              executor, with the ops unrolled, the coefficients
+ *              inlined and the zero taps dropped.
+ *
+ *      @param  path const char* - The header to write
+ *      @param  className const char* - Name of the generated class
+ *     @return  true if the file could be written, false without a
+ *               loaded graph too
+ */
+bool FilterGraph::generate(const char* path, const char* className)
+{
+    if (ops_.empty())
+        return false;
+
+    FILE* f = fopen(path, "w");
+    if (f == 0)
+        return false;
+
+    int states = (int)state_.size();
+    fprintf(f, "// Generated by FilterGraph, do not edit\n\n");
+    fprintf(f, "class %s\n{\n  public:\n", className);
+    fprintf(f, "    %s() {reset();}\n\n", className);
+    fprintf(f, "    void reset()\n    {\n");
+    for (int k = 0; k < states; k++)
+        fprintf(f, "        s[%d] = 0.0;\n", k);
+    for (size_t i = 0; i < ops_.size(); i++)
+        if (ops_[i].kind == OP_DELAY)
+            fprintf(f, "        s[%d] = %.17g;\n", ops_[i].state, coef_[ops_[i].coef]);
+    fprintf(f, "        k = 0;\n    }\n\n");
+
+    fprintf(f, "    void step(const double* in, double* out)\n    {\n");
+    for (size_t i = 0; i < ops_.size(); i++)
+    {
+        const Op& op = ops_[i];
+        const double* c = coef_.empty() ? 0 : &coef_[op.coef];
+        fprintf(f, "        // %s\n", nodes_[op.node].name.c_str());
+        switch (op.kind)
+        {
+        case OP_INPUT:
+            fprintf(f, "        const double y%d = in[%d];\n", op.out, op.in);
+            break;
+        case OP_CONST:
+            fprintf(f, "        const double y%d = %.17g;\n", op.out, c[0]);
+            break;
+        case OP_PULSE:
+            fprintf(f, "        const double y%d = (k >= %ld && (k - %ld) %% %ld < %ld) ? %.17g : 0.0;\n",
+                    op.out, (long)c[3], (long)c[3], (long)c[1], (long)c[2], c[0]);
+            break;
+        case OP_GAIN:
+            fprintf(f, "        const double y%d = %.17g * y%d;\n", op.out, c[0], op.in);
+            break;
+        case OP_SUM:
+            fprintf(f, "        const double y%d =", op.out);
+            for (int k = 0; k < op.count; k++)
+                fprintf(f, " %s y%d", c[k] < 0 ? "-" : (k ? "+" : ""), args_[op.in + k]);
+            fprintf(f, ";\n");
+            break;
+        case OP_DELAY:
+            fprintf(f, "        const double y%d = s[%d];\n", op.out, op.state);
+            break;
+        case OP_IIR:
+            if (op.count == 0)
+                fprintf(f, "        const double y%d = %.17g * y%d;\n", op.out, c[0], op.in);
+            else if (c[0] == 0.0)
+                fprintf(f, "        const double y%d = s[%d];\n", op.out, op.state);
+            else
+                fprintf(f, "        const double y%d = %.17g * y%d + s[%d];\n", op.out, c[0], op.in, op.state);
+            break;
+        }
+
+        // feedthrough filters update right away, the others at the end
+        if (op.kind == OP_IIR && op.count > 0 && c[0] != 0.0)
+            emitStates(f, op.state, op.count, op.in, op.out, c);
+    }
+
+    for (size_t i = 0; i < updates_.size(); i++)
+    {
+        const Op& op = updates_[i];
+        if (op.kind == OP_DELAY)
+            fprintf(f, "        s[%d] = y%d;\n", op.state, op.in);
+        else
+            emitStates(f, op.state, op.count, op.in, op.out, &coef_[op.coef]);
+    }
+
+    for (size_t k = 0; k < outSignal_.size(); k++)
+        fprintf(f, "        out[%d] = y%d; // %s\n", (int)k, outSignal_[k], outputNames_[k].c_str());
+    fprintf(f, "        k++;\n    }\n\n  private:\n");
+    fprintf(f, "    double s[%d];\n    long k;\n};\n", states > 0 ? states : 1);
+    fclose(f);
+    return true;
+}
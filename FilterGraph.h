@@ -0,0 +1,163 @@
+/** Filter graphs imported from Simulink
+ *
+ *           \class  FilterGraph
+ *
+ *                   Reads the block diagram of a Simulink .mdl file
+ *                   (e.g. testFIR4.mdl) and runs it as a statically
+ *                   scheduled dataflow graph, so that new filter
+ *                   topologies do not have to be hand coded like the
+ *                   resonator of Uico.\n
+ *
+ *                   Supported blocks:\n
+ *                   \b Gain, \b Sum, \b UnitDelay, \b Constant,
+ *                   \b DiscreteTransferFcn, \b DiscretePulseGenerator
+ *                   (sample based), \b Inport, \b Outport, \b Scope and
+ *                   the DSP \b Digital \b Filter (FIR, IIR direct form
+ *                   and biquad SOS with scale values).
+ *                   Parameters must be numeric literals.\n
+ *
+ *                   load() parses the file, lowers every block to the
+ *                   primitive ops of FilterGraph::Node, folds gains into
+ *                   the neighbouring filters, orders the ops
+ *                   topologically (delays and strictly proper filters
+ *                   break loops) and allocates all signal, coefficient
+ *                   and state buffers once. step() then walks a flat op
+ *                   list without allocating; generate() writes the same
+ *                   schedule as straight-line C++ with the coefficients
+ *                   inlined.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef FilterGraph_h_
+#define FilterGraph_h_
+
+#include <string>
+#include <vector>
+
+// =====================================================================================
+// =====================================================================================
+class FilterGraph
+{
+
+  public:
+
+    /*! Primitive ops of the lowered graph */
+    enum Kind
+    {
+        OP_INPUT,   /*!< external input, index in \b port */
+        OP_CONST,   /*!< gain */
+        OP_PULSE,   /*!< gain if (k-phase) mod period < width */
+        OP_GAIN,    /*!< gain * in[0] */
+        OP_SUM,     /*!< sum of signs[i] * in[i] */
+        OP_DELAY,   /*!< in[0] one tick later, starts at gain */
+        OP_IIR      /*!< num/den, direct form II transposed */
+    };
+
+    /*! One op of the dataflow description */
+    struct Node
+    {
+        Kind kind;
+        std::string name;
+        std::vector<int> in;        /*!< producer node per input port */
+        std::vector<double> signs;  /*!< OP_SUM */
+        std::vector<double> num;    /*!< OP_IIR, den[0] == 1 */
+        std::vector<double> den;
+        double gain;
+        int port;
+        int period, width, phase;   /*!< OP_PULSE */
+        bool dead;                  /*!< folded into another node */
+    };
+
+    // ====================  LIFECYCLE   =========================================
+
+    FilterGraph();
+
+    // ====================  OPERATIONS  =========================================
+
+    /** Import a Simulink model
+     *
+     *      @param  path const char* - The .mdl file
+     *     @return  false with getError() set if the model uses
+     *              anything outside the supported subset
+     */
+    bool load(const char* path);
+
+    /*! As load() on the text of a model */
+    bool parse(const std::string& text);
+
+    /** One tick
+     *
+     *              Does nothing without a loaded graph.
+     *
+     *      @param  in const double* - getInputCount() values (may be 0)
+     *      @param  out double* - getOutputCount() values
+     */
+    void step(const double* in, double* out);
+
+    /*! n ticks, in and out are n rows of inputs and outputs */
+    void run(int n, const double* in, double* out);
+
+    /*! Zero all the filter states and the pulse clocks */
+    void reset();
+
+    /** Write the schedule as a C++ class
+     *
+     *      @param  path const char* - The header to write
+     *      @param  className const char* - Name of the generated class
+     *     @return  true if the file could be written, false without a
+     *              loaded graph too
+     */
+    bool generate(const char* path, const char* className);
+
+    // ====================  INQUIRY     =========================================
+
+    int getInputCount() {return (int)inputs_.size();};
+    int getOutputCount() {return (int)outputs_.size();};
+    const char* getOutputName(int i) {return outputNames_[i].c_str();};
+    const char* getError() {return error_.c_str();};
+    const std::vector<Node>& getNodes() {return nodes_;};
+
+  private:
+
+    /*! One op of the executor, indices into the flat buffers */
+    struct Op
+    {
+        int kind;
+        int node;
+        int out;
+        int in;     /*!< first input, or first index in args_ for OP_SUM */
+        int count;  /*!< inputs of OP_SUM, order of OP_IIR */
+        int coef;
+        int state;
+    };
+
+    bool fail(const std::string& what);
+    void fuse();
+    bool schedule();
+    void compile();
+    static bool feedthrough(const Node& n);
+
+    std::vector<Node> nodes_;
+    std::vector<int> inputs_;
+    std::vector<int> outputs_;
+    std::vector<std::string> outputNames_;
+
+    /*! Output phase in topological order, then the state updates */
+    std::vector<Op> ops_;
+    std::vector<Op> updates_;
+
+    std::vector<double> signal_;
+    std::vector<double> coef_;
+    std::vector<double> state_;
+    std::vector<int> args_;
+    std::vector<int> outSignal_;
+    long tick_;
+
+    std::string error_;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/** C interface of the Ico controller
+ *
+ *                   See IcoApi.h. The handle is the Uico itself.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "IcoApi.h"
+
+#include <new>
+#include <stddef.h>
+
+/*! Sizes of the version 1 structs, the smallest a caller may pass */
+#define ICO_BUFFERS_V1 (offsetof(IcoBuffers, distal_right) + sizeof(float*))
+#define ICO_STATE_V1   (offsetof(IcoState, out_right) + sizeof(signed char))
+
+struct IcoController
+{
+    Uico uico;
+
+    IcoController(float f, float q) : uico(f, q) {}
+};
+
+/*! Maps Uico::err to the error codes of the ABI */
+static int fqError(Uico& uico)
+{
+	switch (uico.getError())
+	{
+	case 0:  return 0;
+	case 1:  return ICO_ERR_ROOT;
+	default: return ICO_ERR_QUALITY;
+	}
+}
+
+int ICO_CALL ico_version(void)
+{
+	return ICO_API_VERSION;
+}
+
+IcoController* ICO_CALL ico_create(float f, float q)
+{
+	IcoController* controller = new (std::nothrow) IcoController(f, q);
+	if (controller && fqError(controller->uico) != 0)
+	{
+		delete controller;
+		return 0;
+	}
+	return controller;
+}
+
+void ICO_CALL ico_destroy(IcoController* controller)
+{
+	delete controller;
+}
+
+int ICO_CALL ico_set_fq(IcoController* controller, float f, float q)
+{
+	if (!controller)
+		return ICO_ERR_NULL;
+	controller->uico.setFQ(f, q);
+	return fqError(controller->uico);
+}
+
+/** n ticks of Uico::step over the caller's arrays
+ *
+ *              Reads and writes the arrays in place; the whole batch
+ *              runs inside the library.
+ *
+ *      @param  controller IcoController* - The handle
+ *      @param  buffers const IcoBuffers* - The caller's arrays
+ *      @param  n ico_count - Number of ticks
+ *     @return  n, or a negative error code
+ */
+ico_count ICO_CALL ico_step(IcoController* controller, const IcoBuffers* buffers, ico_count n)
+{
+	if (!controller || !buffers)
+		return ICO_ERR_NULL;
+	if (buffers->size < ICO_BUFFERS_V1)
+		return ICO_ERR_SIZE;
+	if (n < 0)
+		return ICO_ERR_COUNT;
+
+	Uico& uico = controller->uico;
+	const IcoBuffers& b = *buffers;
+
+	for (ico_count i = 0; i < n; i++)
+	{
+		uico.step(b.proximal ? b.proximal[i] : 0,
+		          b.distal ? b.distal[i] : 0,
+		          b.left ? b.left[i] : 0.0f,
+		          b.right ? b.right[i] : 0.0f,
+		          b.left_bump ? b.left_bump[i] : 0,
+		          b.right_bump ? b.right_bump[i] : 0);
+
+		if (b.u0) b.u0[i] = uico.u0;
+		if (b.u1) b.u1[i] = uico.u1;
+		if (b.ul) b.ul[i] = uico.ul;
+		if (b.ur) b.ur[i] = uico.ur;
+		if (b.out_left) b.out_left[i] = uico.getLeftOutput();
+		if (b.out_right) b.out_right[i] = uico.getRightOutput();
+		if (b.distal_left) b.distal_left[i] = uico.getDistalLeft();
+		if (b.distal_right) b.distal_right[i] = uico.getDistalRight();
+	}
+	return n;
+}
+
+int ICO_CALL ico_get_state(IcoController* controller, IcoState* state)
+{
+	if (!controller || !state)
+		return ICO_ERR_NULL;
+	if (state->size < ICO_STATE_V1)
+		return ICO_ERR_SIZE;
+
+	Uico& uico = controller->uico;
+	state->u0 = uico.u0;
+	state->u1 = uico.u1;
+	state->ul = uico.ul;
+	state->ur = uico.ur;
+	for (int k = 0; k < 4; k++)
+		state->weights[k] = uico.getWeight(k);
+	state->out_left = uico.getLeftOutput();
+	state->out_right = uico.getRightOutput();
+	return 0;
+}
+
+int ICO_CALL ico_get_weights(IcoController* controller, float* weights)
+{
+	if (!controller || !weights)
+		return ICO_ERR_NULL;
+	for (int k = 0; k < 4; k++)
+		weights[k] = controller->uico.getWeight(k);
+	return 0;
+}
@@ -0,0 +1,144 @@
+/** C interface of the Ico controller
+ *
+ *                   Stable C ABI of IcoLib.dll for analysis tools
+ *                   outside C++ (NumPy/ctypes, MATLAB loadlibrary,
+ *                   Julia ccall), so that they drive Uico directly
+ *                   instead of running IcoTest.exe and parsing its CSV.\n
+ *
+ *                   ico_step() runs \b n ticks over arrays owned by
+ *                   the caller: inputs are read and results written in
+ *                   place, one call per batch, nothing is copied.\n
+ *
+ *                   The structs start with their own \b size, set by
+ *                   the caller to sizeof(), so that fields can be added
+ *                   at the end without breaking older callers: the
+ *                   library only requires the version 1 fields and
+ *                   reads later ones when \b size covers them.
+ *                   Functions never throw; failures return 0/NULL or a
+ *                   negative code. Counts are 64 bit on every
+ *                   platform.\n
+ *
+ *                   IcoLib.vcproj builds the DLL for Win32 and x64
+ *                   (64 bit MATLAB, NumPy and Julia need the latter).
+ *                   There is no .so/.dylib build: the non-Windows
+ *                   branches below only keep the header portable, the
+ *                   sources still need the Windows tchar.h of stdafx.h.\n
+ *
+ *                   Python:\n
+ *                   lib = ctypes.CDLL("IcoLib.dll")\n
+ *                   c = lib.ico_create(c_float(0.01), c_float(0.501))\n
+ *                   lib.ico_step(c, byref(buffers), n)
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef IcoApi_h_
+#define IcoApi_h_
+
+#ifdef _WIN32
+#ifdef ICO_EXPORTS
+#define ICO_API __declspec(dllexport)
+#else
+#define ICO_API __declspec(dllimport)
+#endif
+#define ICO_CALL __cdecl
+#else
+#define ICO_API
+#define ICO_CALL
+#endif
+
+#define ICO_API_VERSION 1
+
+/*! Tick counts, the same width for ctypes and ccall everywhere */
+#ifdef _MSC_VER
+typedef __int64 ico_count;
+#else
+#include <stdint.h>
+typedef int64_t ico_count;
+#endif
+
+/*! Error codes, negative */
+#define ICO_ERR_NULL     -1
+#define ICO_ERR_SIZE     -2
+#define ICO_ERR_ROOT     -3  /*!< f and q give no oscillation */
+#define ICO_ERR_QUALITY  -4  /*!< q <= 0 */
+#define ICO_ERR_COUNT    -5  /*!< negative number of ticks */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Opaque handle of one controller */
+typedef struct IcoController IcoController;
+
+/** Caller-owned arrays of a batch
+ *
+ *              Every pointer addresses \b n consecutive elements. NULL
+ *              inputs read as 0, NULL outputs are skipped.
+ */
+typedef struct IcoBuffers
+{
+    unsigned int size;                  /*!< sizeof(IcoBuffers) */
+
+    const int* proximal;                /*!< x0 */
+    const int* distal;                  /*!< x1 */
+    const float* left;                  /*!< antenna inputs of avoid() */
+    const float* right;
+    const unsigned short* left_bump;    /*!< contact switches */
+    const unsigned short* right_bump;
+
+    float* u0;                          /*!< filtered signals, as computed in the tick */
+    float* u1;
+    float* ul;                          /*!< avoidance responses */
+    float* ur;
+    signed char* out_left;              /*!< motor outputs */
+    signed char* out_right;
+    float* distal_left;                 /*!< learned weights after each tick */
+    float* distal_right;
+} IcoBuffers;
+
+/*! State of a controller between two batches */
+typedef struct IcoState
+{
+    unsigned int size;                  /*!< sizeof(IcoState) */
+
+    float u0;
+    float u1;
+    float ul;
+    float ur;
+    float weights[4];                   /*!< distal L, distal R, proximal L, proximal R */
+    signed char out_left;
+    signed char out_right;
+} IcoState;
+
+/*! ICO_API_VERSION of the library */
+ICO_API int ICO_CALL ico_version(void);
+
+/*! A controller with frequency and quality, NULL on failure */
+ICO_API IcoController* ICO_CALL ico_create(float f, float q);
+
+ICO_API void ICO_CALL ico_destroy(IcoController* controller);
+
+/*! Uico::setFQ, 0 or ICO_ERR_ROOT / ICO_ERR_QUALITY */
+ICO_API int ICO_CALL ico_set_fq(IcoController* controller, float f, float q);
+
+/** n ticks of Uico::step over the caller's arrays
+ *
+ *     @return  the number of ticks run, or a negative error code
+ */
+ICO_API ico_count ICO_CALL ico_step(IcoController* controller, const IcoBuffers* buffers, ico_count n);
+
+/*! Snapshot of the state, 0 or a negative error code */
+ICO_API int ICO_CALL ico_get_state(IcoController* controller, IcoState* state);
+
+/*! The 4 synaptic weights, same order as IcoState::weights */
+ICO_API int ICO_CALL ico_get_weights(IcoController* controller, float* weights);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
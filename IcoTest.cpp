@@ -2,10 +2,393 @@
 //
 
 #include "stdafx.h"
+#include "IcoTune.h"
+#include "FilterGraph.h"
+#include "SharedWeights.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#endif
 
+/* wall clock in seconds for the benchmarks */
+static double now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER t,f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return (double)t.QuadPart/(double)f.QuadPart;
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec+t.tv_nsec*1e-9;
+#endif
+}
+
+
+/* command line arguments as plain char strings */
+static void narrow(const _TCHAR* in, char* out, int size)
+{
+#ifdef _UNICODE
+	wcstombs(out, in, size);
+#else
+	strncpy(out, in, size);
+#endif
+	out[size-1]=0;
+}
+
+/* IcoTest graph <model.mdl> [steps] [header]: run an imported Simulink
+   filter graph into graph.csv, optionally writing it as a C++ class */
+static int runGraph(const _TCHAR* model, int steps, const _TCHAR* header)
+{
+	char path[260];
+	narrow(model,path,sizeof(path));
+	FilterGraph graph;
+	if(!graph.load(path))
+	{
+		printf("Cannot import %s: %s\n",path,graph.getError());
+		return 1;
+	}
+
+	FILE* pGraph = fopen("graph.csv","wb");
+	if(pGraph==0)
+	{
+		printf("Cannot write graph.csv\n");
+		return 1;
+	}
+	fprintf(pGraph,"Time");
+	for(int k=0; k<graph.getOutputCount(); k++)
+		fprintf(pGraph,",%s",graph.getOutputName(k));
+	fprintf(pGraph,"\n");
+
+	/* inports are driven with a unit pulse every 100 steps; one spare
+	   element keeps &in[0] and &out[0] valid for empty graphs */
+	std::vector<double> in(graph.getInputCount()+1,0.0);
+	std::vector<double> out(graph.getOutputCount()+1,0.0);
+	for(int i=0; i<steps; ++i)
+	{
+		for(int k=0; k<graph.getInputCount(); k++)
+			in[k]=(i%100==0 ? 1 : 0);
+		graph.step(&in[0],&out[0]);
+		fprintf(pGraph,"%d",i);
+		for(int k=0; k<graph.getOutputCount(); k++)
+			fprintf(pGraph,",%f",out[k]);
+		fprintf(pGraph,"\n");
+	}
+	fclose(pGraph);
+
+	if(header)
+	{
+		narrow(header,path,sizeof(path));
+		if(!graph.generate(path,"FilterGraphStep"))
+		{
+			printf("Cannot write %s\n",path);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* IcoTestOld pulse pairs: distal leads proximal by two ticks */
+static void pulsePairs(int i, int* proximal, int* distal)
+{
+	int m=i%200;
+	*proximal=(m>=20 && m<=24 ? -1 : 0);
+	*distal=(m>=18 && m<=20 ? -1 : 0);
+}
+
+/* IcoTest tune [iterations]: fits f, q and the learning rate so that the
+   pulse pairs learn distal weights of -1/+1 in 2000 steps, after checking
+   the Dual gradient against central differences */
+static int runTune(int iterations)
+{
+	const int steps=2000;
+	const char* names[DUAL_N]={"f","q","rate","bias"};
+	IcoTune tune(pulsePairs,steps);
+	tune.setTarget(-1.0,1.0);
+	float param[DUAL_N]={0.01f,0.51f,1.0f,0.0f};
+
+	float grad[DUAL_N];
+	float loss=tune.run(param,grad);
+	printf("Gradient check at f %g q %g rate %g, loss %g\n",param[DUAL_F],param[DUAL_Q],param[DUAL_RATE],loss);
+	printf("%6s %14s %14s\n","","dual","central diff");
+	for(int k=0; k<DUAL_N; k++)
+	{
+		float h=(param[k]!=0 ? param[k] : 1.0f)*1e-3f;
+		float hi=param[k]+h;
+		float lo=param[k]-h;
+		float trial[DUAL_N];
+		for(int j=0; j<DUAL_N; j++)
+			trial[j]=param[j];
+		trial[k]=hi;
+		float up=tune.run(trial,0);
+		trial[k]=lo;
+		float down=tune.run(trial,0);
+		printf("%6s %14.6g %14.6g\n",names[k],grad[k],(up-down)/(hi-lo));
+	}
+
+	loss=tune.tune(param,iterations);
+	printf("Tuned f %g q %g rate %g, loss %g\n",param[DUAL_F],param[DUAL_Q],param[DUAL_RATE],loss);
+
+	/* replay on Uico */
+	Uico controller(param[DUAL_F],param[DUAL_Q]);
+	controller.setLearningRate(param[DUAL_RATE]);
+	int proximal,distal;
+	for(int i=0; i<steps; ++i)
+	{
+		pulsePairs(i,&proximal,&distal);
+		controller.setProximal(proximal);
+		controller.setDistal(distal);
+		controller.filterBP();
+		controller.calculate();
+	}
+	printf("Left syn %f Right syn %f \n",controller.getDistalLeft(),controller.getDistalRight());
+	return 0;
+}
+
+/* IcoTest bench step [ticks]: the fused Uico::step() against the separate
+   avoid(), filterBP() and calculate() calls on the pulse pairs with
+   antenna hits and contact bursts, best of five alternating rounds */
+static int benchStep(int ticks)
+{
+	Uico fused(0.01,0.501);
+	Uico scalar(0.01,0.501);
+	int proximal,distal;
+	double tFused=1e30,tScalar=1e30;
+
+	for(int round=0; round<5; round++)
+	{
+		double start=now();
+		for(int i=0; i<ticks; ++i)
+		{
+			pulsePairs(i,&proximal,&distal);
+			unsigned short bump=(i%1000>=500 && i%1000<510);
+			fused.step(proximal,distal,i%200==0 ? 1.0f : 0.0f,0.0f,bump,bump);
+		}
+		double elapsed=now()-start;
+		if(elapsed<tFused) tFused=elapsed;
+
+		start=now();
+		for(int i=0; i<ticks; ++i)
+		{
+			pulsePairs(i,&proximal,&distal);
+			scalar.left_bump=scalar.right_bump=(i%1000>=500 && i%1000<510);
+			scalar.avoid(i%200==0 ? 1.0f : 0.0f,0.0f);
+			scalar.setProximal(proximal);
+			scalar.setDistal(distal);
+			scalar.filterBP();
+			scalar.calculate();
+		}
+		elapsed=now()-start;
+		if(elapsed<tScalar) tScalar=elapsed;
+	}
+
+	bool same=fused.u0==scalar.u0 && fused.u1==scalar.u1 && fused.ul==scalar.ul && fused.ur==scalar.ur
+		&& fused.getLeftOutput()==scalar.getLeftOutput() && fused.getRightOutput()==scalar.getRightOutput();
+	for(int k=0; k<4; k++)
+		same=same && fused.getWeight(k)==scalar.getWeight(k);
+
+	printf("Step benchmark: %d ticks\n",ticks);
+	printf("fused  %8.2f ns per tick\n",tFused*1e9/ticks);
+	printf("scalar %8.2f ns per tick\n",tScalar*1e9/ticks);
+	printf("final state %s\n",same ? "identical" : "DIFFERENT");
+	return same ? 0 : 1;
+}
+
+/* IcoTest bench denormal: tick latency after sparse antenna hits, with the
+   avoidance and resonator state decaying through the subnormal range */
+static int benchDenormal()
+{
+	const int period=2000;     // one pulse pair and one antenna hit per period
+	const int events=2000;
+	const int window=50;       // ticks per timed window
+	const int windows=period/window;
+
+	printf("Denormal benchmark: %d events, ns per tick after each event\n",events);
+	printf("%10s %12s %12s\n","ticks","normal","safe");
+
+	double latency[2][windows];
+	unsigned long counts[2][STAGE_COUNT];
+	for(int mode=0; mode<2; mode++)
+	{
+		Uico controller(0.01,0.501);
+		controller.setDenormalSafe(mode==1);
+		bool ftz=Uico::setFlushToZero(mode==1);
+		for(int w=0; w<windows; w++)
+			latency[mode][w]=0;
+
+		for(int e=0; e<events; e++)
+			for(int w=0; w<windows; w++)
+			{
+				double start=now();
+				for(int k=w*window; k<(w+1)*window; k++)
+				{
+					controller.avoid(k==0 ? 1.0 : 0.0,k==0 ? 0.5 : 0.0);
+					controller.setProximal(k>=20 && k<=24 ? -1 : 0);
+					controller.setDistal(k>=18 && k<=20 ? -1 : 0);
+					controller.filterBP();
+					controller.calculate();
+				}
+				latency[mode][w]+=now()-start;
+			}
+
+		for(int k=0; k<STAGE_COUNT; k++)
+			counts[mode][k]=controller.getDenormalCount(k);
+		Uico::setFlushToZero(ftz);
+	}
+
+	for(int w=0; w<windows; w++)
+		printf("%5d-%-5d %12.2f %12.2f\n",w*window,(w+1)*window-1,
+			latency[0][w]*1e9/((double)events*window),latency[1][w]*1e9/((double)events*window));
+	printf("subnormal values normal: filter %lu avoid %lu learn %lu\n",counts[0][STAGE_FILTER],counts[0][STAGE_AVOID],counts[0][STAGE_LEARN]);
+	printf("flushed values safe:     filter %lu avoid %lu learn %lu\n",counts[1][STAGE_FILTER],counts[1][STAGE_AVOID],counts[1][STAGE_LEARN]);
+	return 0;
+}
+
+/* one agent of the shared-weight benchmark */
+struct Agent
+{
+	Uico* controller;
+	int ticks;
+};
+
+/* one tick of the pulse pairs */
+static void tickAgent(Uico* controller, int i)
+{
+	int proximal,distal;
+	pulsePairs(i,&proximal,&distal);
+	controller->step(proximal,distal,0.0,0.0,0,0);
+}
+
+static void* agentMain(void* p)
+{
+	Agent* agent=(Agent*)p;
+	for(int i=0; i<agent->ticks; ++i)
+		tickAgent(agent->controller,i);
+	agent->controller->mergeShared();
+	return 0;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI agentThread(LPVOID p)
+{
+	agentMain(p);
+	return 0;
+}
+#endif
+
+/* runs every agent on its own thread, returns the wall time */
+static double runAgents(Agent* agents, int count)
+{
+	double start=now();
+#ifdef _WIN32
+	HANDLE threads[64];
+	for(int t=0; t<count; t++)
+		threads[t]=CreateThread(0,0,agentThread,&agents[t],0,0);
+	WaitForMultipleObjects(count,threads,TRUE,INFINITE);
+	for(int t=0; t<count; t++)
+		CloseHandle(threads[t]);
+#else
+	pthread_t threads[64];
+	for(int t=0; t<count; t++)
+		pthread_create(&threads[t],0,agentMain,&agents[t]);
+	for(int t=0; t<count; t++)
+		pthread_join(threads[t],0);
+#endif
+	return now()-start;
+}
+
+/* IcoTest bench shared [threads] [ticks]: Hogwild learning of many agents
+   into one SharedWeights against the same agents ticked in turn */
+static int benchShared(int count, int ticks)
+{
+	if(count<1) count=1;
+	if(count>64) count=64;
+	printf("Shared-weight benchmark: %d agents x %d ticks\n",count,ticks);
+	printf("%-14s %10s %12s %12s %10s %10s\n","mode","Mticks/s","distal L","distal R","drift","retries");
+
+	/* serial baseline: the same agents interleaved on one thread */
+	SharedWeights serial;
+	Uico* controllers[64];
+	for(int t=0; t<count; t++)
+	{
+		controllers[t]=new Uico(0.01,0.501);
+		controllers[t]->setSharedWeights(&serial);
+	}
+	double start=now();
+	for(int i=0; i<ticks; ++i)
+		for(int t=0; t<count; t++)
+			tickAgent(controllers[t],i);
+	double elapsed=now()-start;
+	unsigned long retries=0;
+	for(int t=0; t<count; t++)
+	{
+		controllers[t]->setSharedWeights(0);
+		retries+=controllers[t]->getSharedRetries();
+	}
+	float base[4];
+	serial.read(base);
+	printf("%-14s %10.2f %12.4f %12.4f %10s %10lu\n","serial",count*(double)ticks/elapsed*1e-6,base[DISTAL_L],base[DISTAL_R],"-",retries);
+
+	/* private weights on every thread: the scaling without sharing */
+	Agent agents[64];
+	for(int t=0; t<count; t++)
+	{
+		agents[t].controller=controllers[t];
+		agents[t].ticks=ticks;
+	}
+	elapsed=runAgents(agents,count);
+	printf("%-14s %10.2f %12s %12s %10s %10s\n","private",count*(double)ticks/elapsed*1e-6,"-","-","-","-");
+	for(int t=0; t<count; t++)
+		delete controllers[t];
+
+	const int merges[3]={0,16,256};
+	for(int m=0; m<3; m++)
+	{
+		SharedWeights shared;
+		for(int t=0; t<count; t++)
+		{
+			controllers[t]=new Uico(0.01,0.501);
+			controllers[t]->setSharedWeights(&shared,merges[m]);
+			agents[t].controller=controllers[t];
+		}
+		elapsed=runAgents(agents,count);
+
+		/* the retries are counted per agent and summed after the join;
+		   deleting detaches, before shared goes out of scope */
+		retries=0;
+		for(int t=0; t<count; t++)
+		{
+			retries+=controllers[t]->getSharedRetries();
+			delete controllers[t];
+		}
+
+		float w[4];
+		shared.read(w);
+		double drift=(fabs(w[DISTAL_L]-base[DISTAL_L])+fabs(w[DISTAL_R]-base[DISTAL_R]))
+			/(fabs(base[DISTAL_L])+fabs(base[DISTAL_R]));
+		char mode[32];
+		sprintf(mode,merges[m] ? "merge/%d" : "atomic",merges[m]);
+		printf("%-14s %10.2f %12.4f %12.4f %9.4f%% %10lu\n",mode,count*(double)ticks/elapsed*1e-6,w[DISTAL_L],w[DISTAL_R],drift*100,retries);
+	}
+	return 0;
+}
 
 int _tmain(int argc, _TCHAR* argv[])
 {
+	if(argc>2 && _tcscmp(argv[1],_T("graph"))==0)
+		return runGraph(argv[2],argc>3 ? _ttoi(argv[3]) : 400,argc>4 ? argv[4] : 0);
+	if(argc>1 && _tcscmp(argv[1],_T("tune"))==0)
+		return runTune(argc>2 ? _ttoi(argv[2]) : 50);
+	if(argc>2 && _tcscmp(argv[1],_T("bench"))==0 && _tcscmp(argv[2],_T("step"))==0)
+		return benchStep(argc>3 ? _ttoi(argv[3]) : 2000000);
+	if(argc>2 && _tcscmp(argv[1],_T("bench"))==0 && _tcscmp(argv[2],_T("denormal"))==0)
+		return benchDenormal();
+	if(argc>2 && _tcscmp(argv[1],_T("bench"))==0 && _tcscmp(argv[2],_T("shared"))==0)
+		return benchShared(argc>3 ? _ttoi(argv[3]) : 4,argc>4 ? _ttoi(argv[4]) : 1000000);
+
 	  FILE * pFile;
 	  FILE * pRaw;
 
@@ -14,6 +397,10 @@ int _tmain(int argc, _TCHAR* argv[])
 		float f=0.01;
 		float q=0.501;
 	    Uico controller(f,q);
+		/* u0,u1,ul,ur,distal weights and motor outputs, browsable with loadlod.m */
+		TracePyramid lod(8);
+		lod.create("iconew");
+		float sample[8];
 
 		int N=400;
 		int proximal;
@@ -36,11 +423,22 @@ int _tmain(int argc, _TCHAR* argv[])
 			  fprintf (pFile,"%d,%d,%d,%f,%f,%f,%f\n",i,proximal,distal,controller.getU0(),controller.getU1(),controller.ul,controller.ur);
 			  fprintf (pRaw,"%d,%d,%d,%d,%d,%d,%d\n",i,proximal,distal,controller.getLeftOutput(),controller.getRightOutput(),(int)controller.getDistalLeft(),(int)controller.getDistalRight());
 
+			  sample[0]=controller.getU0();
+			  sample[1]=controller.getU1();
+			  sample[2]=controller.ul;
+			  sample[3]=controller.ur;
+			  sample[4]=controller.getDistalLeft();
+			  sample[5]=controller.getDistalRight();
+			  sample[6]=controller.getLeftOutput();
+			  sample[7]=controller.getRightOutput();
+			  lod.append(sample);
+
 		  }
     printf("Left syn %f Right syn %f \n",controller.getDistalLeft(),controller.getDistalRight());
 	printf("Sum pos %f Sum neg %f \n",controller.sumpos,controller.sumneg);
     fclose (pFile);
 	fclose (pRaw);
+	lod.close();
 	return 0;
 }
 
@@ -0,0 +1,135 @@
+/** Gradient based tuning of f, q, learning rate and bias
+ *
+ *           \class  IcoTune
+ *
+ *                   See IcoTune.h.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "IcoTune.h"
+
+/*! Bounds keeping setFQ in its valid region */
+#define TUNE_F_MIN 0.0005
+#define TUNE_F_MAX 0.4999
+#define TUNE_Q_MIN 0.5005
+
+IcoTune::IcoTune(IcoScenario scenario, int steps)
+{
+	scenario_=scenario;
+	steps_=steps;
+	targetLeft_=-0.1;
+	targetRight_=0.1;
+	outputLeft_=50.0;
+	outputRight_=50.0;
+	lambda_=0.0;
+}
+
+/** One differentiated run
+ *
+ *              Replays the scenario on UicoSens the way IcoTest drives
+ *              Uico (setProximal, setDistal, filterBP, calculate).
+ *
+ *      @param  param float[DUAL_N] - f, q, learning rate, bias
+ *      @param  grad float[DUAL_N] - Gradient of the loss (may be 0)
+ *     @return  the loss, negative if setFQ rejected f and q
+ */
+float IcoTune::run(const float* param, float* grad)
+{
+	UicoSens controller(param[DUAL_F],param[DUAL_Q],param[DUAL_RATE],param[DUAL_BIAS]);
+	if (controller.getError() != 0)
+		return -1.0;
+
+	int proximal, distal;
+	for (int i=0; i<steps_; ++i)
+	{
+		scenario_(i,&proximal,&distal);
+		controller.setProximal(proximal);
+		controller.setDistal(distal);
+		controller.filterBP();
+		controller.calculate();
+	}
+
+	Dual eL = controller.getDistalLeft() - Dual(targetLeft_);
+	Dual eR = controller.getDistalRight() - Dual(targetRight_);
+	Dual loss = eL * eL + eR * eR;
+	if (lambda_ > 0)
+	{
+		Dual oL = controller.getLeftOutput() - Dual(outputLeft_);
+		Dual oR = controller.getRightOutput() - Dual(outputRight_);
+		loss += Dual(lambda_) * (oL * oL + oR * oR);
+	}
+
+	if (grad)
+		for (int k=0; k<DUAL_N; k++)
+			grad[k]=(float)loss.d[k];
+	return (float)loss.v;
+}
+
+/** Projected gradient descent
+ *
+ *      @param  param float[DUAL_N] - Start point, overwritten
+ *      @param  iterations int - Number of runs
+ *      @param  step float - Relative step size
+ *     @return  the loss at the returned parameters
+ *
+ *    @remarks  The step is halved whenever the loss goes up, and the
+ *              previous point is kept.
+ */
+float IcoTune::tune(float* param, int iterations, float step)
+{
+	float grad[DUAL_N];
+	float best = run(param,grad);
+	if (best < 0)
+		return best;
+
+	for (int it=0; it<iterations; it++)
+	{
+		/* relative steps for f and q, absolute for rate and bias: the
+		   gradient is normalized in these scaled coordinates */
+		double scaled[DUAL_N];
+		double norm = 0;
+		for (int k=0; k<DUAL_N; k++)
+		{
+			scaled[k] = grad[k] * ((k == DUAL_F || k == DUAL_Q) ? param[k] : 1.0f);
+			norm += scaled[k]*scaled[k];
+		}
+		if (norm == 0)
+			break;
+		norm = sqrt(norm);
+
+		float trial[DUAL_N];
+		for (int k=0; k<DUAL_N; k++)
+		{
+			float scale = (k == DUAL_F || k == DUAL_Q) ? param[k] : 1.0f;
+			trial[k] = param[k] - step * scale * (float)(scaled[k] / norm);
+		}
+		if (trial[DUAL_F] < TUNE_F_MIN) trial[DUAL_F] = TUNE_F_MIN;
+		if (trial[DUAL_F] > TUNE_F_MAX) trial[DUAL_F] = TUNE_F_MAX;
+		if (trial[DUAL_Q] < TUNE_Q_MIN) trial[DUAL_Q] = TUNE_Q_MIN;
+		if (trial[DUAL_RATE] < 0) trial[DUAL_RATE] = 0;
+
+		float trialGrad[DUAL_N];
+		float loss = run(trial,trialGrad);
+		if (loss >= 0 && loss < best)
+		{
+			best = loss;
+			for (int k=0; k<DUAL_N; k++)
+			{
+				param[k] = trial[k];
+				grad[k] = trialGrad[k];
+			}
+		}
+		else
+			step *= 0.5;
+	}
+	return best;
+}
@@ -0,0 +1,85 @@
+/** Gradient based tuning of f, q, learning rate and bias
+ *
+ *           \class  IcoTune
+ *
+ *                   Replaces the brute-force sweeps over setFQ and the
+ *                   learning rate: every iteration runs the scenario
+ *                   once on UicoSens, which yields the loss and its
+ *                   gradient, and takes a projected gradient step.\n
+ *
+ *                   The loss is
+ *                   \f[
+ *                   (w_{DL}-t_L)^2 + (w_{DR}-t_R)^2 +
+ *                   \lambda ((o_L-m_L)^2 + (o_R-m_R)^2)
+ *                   \f]
+ *                   on the final distal weights \f$w\f$ and motor
+ *                   outputs \f$o\f$. The bias only moves the outputs,
+ *                   so it stays put unless \f$\lambda > 0\f$.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef IcoTune_h_
+#define IcoTune_h_
+
+#include "UicoSens.h"
+
+/*! Sensor inputs of one tick of a scenario */
+typedef void (*IcoScenario)(int step, int* proximal, int* distal);
+
+// =====================================================================================
+// =====================================================================================
+class IcoTune
+{
+
+  public:
+
+    // ====================  LIFECYCLE   =========================================
+
+    IcoTune(IcoScenario scenario, int steps);
+
+    // ====================  OPERATIONS  =========================================
+
+    void setTarget(float left, float right) {targetLeft_=left; targetRight_=right;};
+    void setOutputTarget(float left, float right, float lambda)
+        {outputLeft_=left; outputRight_=right; lambda_=lambda;};
+
+    /** One differentiated run
+     *
+     *      @param  param float[DUAL_N] - f, q, learning rate, bias
+     *      @param  grad float[DUAL_N] - Gradient of the loss (may be 0)
+     *     @return  the loss, negative if setFQ rejected f and q
+     */
+    float run(const float* param, float* grad);
+
+    /** Projected gradient descent
+     *
+     *              Each parameter moves by step times its scale times
+     *              the gradient normalized in the scaled coordinates
+     *              (f and q relative, rate and bias absolute), and is
+     *              kept inside the range accepted by setFQ
+     *              (q > 0.5, 0 < f < 0.5).
+     *
+     *      @param  param float[DUAL_N] - Start point, overwritten
+     *      @param  iterations int - Number of runs
+     *      @param  step float - Relative step size
+     *     @return  the loss at the returned parameters
+     */
+    float tune(float* param, int iterations, float step=0.05);
+
+  private:
+
+    IcoScenario scenario_;
+    int steps_;
+
+    float targetLeft_;
+    float targetRight_;
+    float outputLeft_;
+    float outputRight_;
+    float lambda_;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/** Synaptic weights shared by many controllers
+ *
+ *           \class  SharedWeights
+ *
+ *                   See SharedWeights.h.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "SharedWeights.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange)
+/* returns the previous value, stores x if it was c */
+#define cas32(p, x, c) _InterlockedCompareExchange((p), (x), (c))
+/* volatile loads are atomic and acquire on MSVC */
+#define load32(p) (*(p))
+#else
+#define cas32(p, x, c) __sync_val_compare_and_swap((p), (c), (x))
+#define load32(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+/*! float <-> bits without breaking strict aliasing */
+union WeightBits
+{
+    weight_bits bits;
+    float value;
+};
+
+SharedWeights::SharedWeights()
+{
+	float w[4];
+	w[DISTAL_L]=-0.1;
+	w[DISTAL_R]=0.1;
+	w[PROXIMAL_L]=-0.1;
+	w[PROXIMAL_R]=0.1;
+	write(w);
+}
+
+void SharedWeights::read(float* w)
+{
+	WeightBits b;
+	for (int k=0; k<4; k++)
+	{
+		b.bits=load32(&bits_[k]);
+		w[k]=b.value;
+	}
+}
+
+void SharedWeights::write(const float* w)
+{
+	WeightBits b;
+	for (int k=0; k<4; k++)
+	{
+		b.value=w[k];
+		bits_[k]=b.bits;
+	}
+}
+
+/** weight[index] += delta
+ *
+ *              Retries while another thread changed the weight between
+ *              the load and the swap.
+ *
+ *      @param  index int - DISTAL_L, DISTAL_R, PROXIMAL_L or PROXIMAL_R
+ *      @param  delta float - The increment
+ *     @return  the number of retries
+ */
+int SharedWeights::add(int index, float delta)
+{
+	if (delta == 0)
+		return 0;
+
+	int retries=0;
+	WeightBits seen, next;
+	seen.bits=load32(&bits_[index]);
+	for (;;)
+	{
+		next.value=seen.value+delta;
+		weight_bits previous=cas32(&bits_[index],next.bits,seen.bits);
+		if (previous==seen.bits)
+			return retries;
+		seen.bits=previous;
+		retries++;
+	}
+}
@@ -0,0 +1,71 @@
+/** Synaptic weights shared by many controllers
+ *
+ *           \class  SharedWeights
+ *
+ *                   One set of the 4 synaptic weights that many Uico,
+ *                   each ticking on its own thread, learn into at the
+ *                   same time (Hogwild style).\n
+ *
+ *                   read() takes a snapshot with plain 32 bit loads,
+ *                   add() applies a delta with a compare and swap loop,
+ *                   so no update is lost and no mutex is taken. The
+ *                   weights sit alone on their cache line.\n
+ *
+ *                   That line moves between the cores on every add(),
+ *                   so adding each tick does not scale: controllers
+ *                   that should use the cores buffer their deltas
+ *                   (Uico::setSharedWeights with mergeEvery > 0).
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef SharedWeights_h_
+#define SharedWeights_h_
+
+#define SHARED_LINE 64
+
+/*! 32 bit integer for the interlocked operations */
+#ifdef _MSC_VER
+typedef long weight_bits;
+#else
+typedef int weight_bits;
+#endif
+
+// =====================================================================================
+// =====================================================================================
+class SharedWeights
+{
+
+  public:
+
+    // ====================  LIFECYCLE   =========================================
+
+    /*! Starts from the initial weights of Uico */
+    SharedWeights();
+
+    // ====================  OPERATIONS  =========================================
+
+    /*! Snapshot of the 4 weights, each load is atomic */
+    void read(float* w);
+
+    /*! Overwrite the 4 weights, not to be mixed with concurrent add() */
+    void write(const float* w);
+
+    /*! weight[index] += delta, lock-free, returns the compare and swap
+        retries, a measure of contention kept by the caller */
+    int add(int index, float delta);
+
+  private:
+
+    char pad0_[SHARED_LINE];
+
+    /*! The float bits of the weights */
+    volatile weight_bits bits_[4];
+
+    char pad1_[SHARED_LINE - 4 * sizeof(weight_bits)];
+};
+
+#endif
@@ -0,0 +1,482 @@
+/** Level of detail trace for long runs
+ *
+ *           \class  TracePyramid
+ *
+ *                   See TracePyramid.h. Level 0 stores the raw float
+ *                   samples, every other level stores one min/max/mean
+ *                   triple per channel and node.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "TracePyramid.h"
+
+#include <limits.h>
+
+/* level files of long runs are bigger than 2GB */
+#ifdef _MSC_VER
+#define lod_seek _fseeki64
+typedef __int64 lod_off;
+#else
+#define lod_seek fseeko
+typedef off_t lod_off;
+#endif
+
+// =====================================================================================
+// Constructor and Destructor
+// =====================================================================================
+
+/** Constructor that sets the shape of the pyramid.
+ *
+ *      @param  channels int - Values per sample (max LOD_MAX_CHANNELS)
+ *      @param  fanout int - Children per node
+ *      @param  levels int - Number of levels including the raw one
+ *
+ */
+TracePyramid::TracePyramid(int channels, int fanout, int levels)
+{
+	channels_ = channels < 1 ? 1 : (channels > LOD_MAX_CHANNELS ? LOD_MAX_CHANNELS : channels);
+	fanout_ = fanout < 2 ? 2 : fanout;
+	levels_ = levels < 1 ? 1 : (levels > LOD_MAX_LEVELS ? LOD_MAX_LEVELS : levels);
+	levels_ = maxLevels(fanout_, levels_);
+	writing_ = false;
+	length_ = 0;
+	base_[0] = 0;
+	scratch_ = 0;
+	scratchSize_ = 0;
+
+	for (int k = 0; k < LOD_MAX_LEVELS; k++)
+	{
+		files_[k] = 0;
+		written_[k] = 0;
+		partialChildren_[k] = 0;
+		partialSamples_[k] = 0;
+	}
+}
+
+TracePyramid::~TracePyramid()
+{
+	close();
+	delete [] scratch_;
+}
+
+// =====================================================================================
+// =====================================================================================
+
+/** Create a new pyramid
+ *
+ *              Opens <base>.lod<k> for every level. The header
+ *              <base>.lod is only written by close().
+ *
+ *      @param  base const char* - Path of the trace without extension
+ *     @return  true if all the files could be created
+ */
+bool TracePyramid::create(const char* base)
+{
+	close();
+	_snprintf(base_, sizeof(base_) - 1, "%s", base);
+	base_[sizeof(base_) - 1] = 0;
+
+	char path[280];
+	for (int k = 0; k < levels_; k++)
+	{
+		_snprintf(path, sizeof(path) - 1, "%s.lod%d", base_, k);
+		path[sizeof(path) - 1] = 0;
+		files_[k] = fopen(path, "w+b");
+		if (files_[k] == 0)
+		{
+			close();
+			return false;
+		}
+		written_[k] = 0;
+		partialChildren_[k] = 0;
+		partialSamples_[k] = 0;
+	}
+	length_ = 0;
+	writing_ = true;
+	return true;
+}
+
+/** Open an existing pyramid
+ *
+ *      @param  base const char* - Path of the trace without extension
+ *     @return  true if the header is valid
+ */
+bool TracePyramid::open(const char* base)
+{
+	close();
+	_snprintf(base_, sizeof(base_) - 1, "%s", base);
+	base_[sizeof(base_) - 1] = 0;
+
+	char path[280];
+	_snprintf(path, sizeof(path) - 1, "%s.lod", base_);
+	path[sizeof(path) - 1] = 0;
+	FILE* header = fopen(path, "r");
+	if (header == 0)
+		return false;
+
+	int ok = fscanf(header, "LOD %d %d %d %ld", &channels_, &fanout_, &levels_, &length_);
+	for (int k = 0; ok == 4 && k < levels_; k++)
+		if (fscanf(header, " %ld", &written_[k]) != 1)
+			ok = 0;
+	fclose(header);
+
+	if (ok != 4 || channels_ < 1 || channels_ > LOD_MAX_CHANNELS
+		|| fanout_ < 2 || levels_ < 1 || levels_ > LOD_MAX_LEVELS
+		|| maxLevels(fanout_, levels_) != levels_)
+		return false;
+
+	for (int k = 0; k < levels_; k++)
+	{
+		_snprintf(path, sizeof(path) - 1, "%s.lod%d", base_, k);
+		path[sizeof(path) - 1] = 0;
+		files_[k] = fopen(path, "rb");
+		partialChildren_[k] = 0;
+		partialSamples_[k] = 0;
+		if (files_[k] == 0)
+		{
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Append one sample
+ *
+ *              Writes the raw values to level 0 and merges them into the
+ *              partial node of level 1, which cascades upwards once
+ *              every fanout children.
+ *
+ *      @param  sample const float* - One value per channel
+ */
+void TracePyramid::append(const float* sample)
+{
+	if (!writing_)
+		return;
+
+	Node raw[LOD_MAX_CHANNELS];
+	for (int c = 0; c < channels_; c++)
+	{
+		raw[c].min = sample[c];
+		raw[c].max = sample[c];
+		raw[c].mean = sample[c];
+	}
+	length_++;
+	push(0, raw, 1);
+}
+
+/** Store a complete node and merge it one level up.
+ *
+ *      @param  level int - Level of the node
+ *      @param  nodes const Node* - One node per channel
+ *      @param  samples long - Number of samples covered by the node
+ */
+void TracePyramid::push(int level, const Node* nodes, long samples)
+{
+	if (level == 0)
+	{
+		float raw[LOD_MAX_CHANNELS];
+		for (int c = 0; c < channels_; c++)
+			raw[c] = nodes[c].mean;
+		fwrite(raw, sizeof(float), channels_, files_[0]);
+	}
+	else
+		fwrite(nodes, sizeof(Node), channels_, files_[level]);
+	written_[level]++;
+
+	int up = level + 1;
+	if (up >= levels_)
+		return;
+
+	Node* partial = partial_[up];
+	double* sum = partialSum_[up];
+	if (partialChildren_[up] == 0)
+	{
+		for (int c = 0; c < channels_; c++)
+		{
+			partial[c] = nodes[c];
+			sum[c] = (double)nodes[c].mean * samples;
+		}
+	}
+	else
+	{
+		for (int c = 0; c < channels_; c++)
+		{
+			if (nodes[c].min < partial[c].min) partial[c].min = nodes[c].min;
+			if (nodes[c].max > partial[c].max) partial[c].max = nodes[c].max;
+			sum[c] += (double)nodes[c].mean * samples;
+		}
+	}
+	partialChildren_[up]++;
+	partialSamples_[up] += samples;
+
+	if (partialChildren_[up] == fanout_)
+	{
+		Node done[LOD_MAX_CHANNELS];
+		long covered = partialSamples_[up];
+		finish(up, done);
+		partialChildren_[up] = 0;
+		partialSamples_[up] = 0;
+		push(up, done, covered);
+	}
+}
+
+/** Copy the partial node of a level with its mean resolved. */
+void TracePyramid::finish(int level, Node* out)
+{
+	for (int c = 0; c < channels_; c++)
+	{
+		out[c] = partial_[level][c];
+		out[c].mean = (float)(partialSum_[level][c] / partialSamples_[level]);
+	}
+}
+
+/** The levels, at most \b levels, whose node span fanout^k fits a long
+ *  (32 bit on MSVC, so 8^10 is the limit there). */
+int TracePyramid::maxLevels(int fanout, int levels)
+{
+	long span = 1;
+	for (int k = 1; k < levels; k++)
+	{
+		if (span > LONG_MAX / fanout)
+			return k;
+		span *= fanout;
+	}
+	return levels;
+}
+
+/** Samples covered by one full node of a level. */
+long TracePyramid::nodeSpan(int level)
+{
+	long span = 1;
+	for (int k = 0; k < level; k++)
+		span *= fanout_;
+	return span;
+}
+
+/** Nodes available on a level, including the partial one. */
+long TracePyramid::nodeCount(int level)
+{
+	for (int k = level; k > 0; k--)
+		if (partialChildren_[k] > 0)
+			return written_[level] + 1;
+	return written_[level];
+}
+
+/** The partial node of a level merged with the partial nodes below it,
+ *  which hold the samples not yet passed up. */
+void TracePyramid::tail(int level, Node* out)
+{
+	double sum[LOD_MAX_CHANNELS];
+	long samples = 0;
+	for (int k = level; k > 0; k--)
+	{
+		if (partialChildren_[k] == 0)
+			continue;
+		for (int c = 0; c < channels_; c++)
+		{
+			const Node& n = partial_[k][c];
+			if (samples == 0)
+			{
+				out[c] = n;
+				sum[c] = partialSum_[k][c];
+				continue;
+			}
+			if (n.min < out[c].min) out[c].min = n.min;
+			if (n.max > out[c].max) out[c].max = n.max;
+			sum[c] += partialSum_[k][c];
+		}
+		samples += partialSamples_[k];
+	}
+	for (int c = 0; c < channels_; c++)
+		out[c].mean = (float)(sum[c] / samples);
+}
+
+/** Read nodes of one level, the last one may still be in memory.
+ *
+ *     @return  false if the level file is closed or too short
+ */
+bool TracePyramid::readNodes(int level, long first, long count, Node* out)
+{
+	long fromFile = written_[level] - first;
+	if (fromFile > count)
+		fromFile = count;
+
+	if (fromFile > 0)
+	{
+		FILE* f = files_[level];
+		if (f == 0)
+			return false;
+		size_t got;
+		if (level == 0)
+		{
+			float* raw = (float*)out;
+			lod_seek(f, (lod_off)first * channels_ * sizeof(float), SEEK_SET);
+			got = fread(raw, sizeof(float), fromFile * channels_, f);
+			/* expand in place from the back, a node is 3 floats */
+			for (long i = fromFile * channels_ - 1; i >= 0; i--)
+			{
+				float v = raw[i];
+				out[i].min = v;
+				out[i].max = v;
+				out[i].mean = v;
+			}
+		}
+		else
+		{
+			lod_seek(f, (lod_off)first * channels_ * sizeof(Node), SEEK_SET);
+			got = fread(out, sizeof(Node), fromFile * channels_, f);
+		}
+		/* keep appending at the end */
+		if (writing_)
+			lod_seek(f, 0, SEEK_END);
+		if (got != (size_t)(fromFile * channels_))
+			return false;
+	}
+	else
+		fromFile = 0;
+
+	if (fromFile < count)
+		tail(level, out + fromFile * channels_);
+	return true;
+}
+
+/** Read a window at screen resolution
+ *
+ *              Picks the coarsest level whose nodes are not wider
+ *              than one bin, reads the covering nodes with a single
+ *              seek and reduces them into \b bins columns.
+ *
+ *      @param  channel int - The channel index
+ *      @param  first long - First sample of the window
+ *      @param  last long - One past the last sample
+ *      @param  bins int - Number of output columns
+ *      @param  mins,maxs,means float* - bins values each (may be 0)
+ *     @return  the number of bins filled, 0 if the pyramid is closed
+ *               or its files cannot be read
+ *
+ *    @remarks  Bins narrower than one sample repeat that sample.
+ */
+int TracePyramid::query(int channel, long first, long last, int bins,
+                        float* mins, float* maxs, float* means)
+{
+	if (channel < 0 || channel >= channels_ || bins < 1)
+		return 0;
+	if (first < 0)
+		first = 0;
+	if (last > length_)
+		last = length_;
+	if (first >= last)
+		return 0;
+
+	long window = last - first;
+	int level = 0;
+	while (level + 1 < levels_ && (double)nodeSpan(level + 1) * bins <= window)
+		level++;
+
+	long span = nodeSpan(level);
+	long nfirst = first / span;
+	long nlast = (last + span - 1) / span;
+	if (nlast > nodeCount(level))
+		nlast = nodeCount(level);
+	long count = nlast - nfirst;
+
+	if (count * channels_ > scratchSize_)
+	{
+		delete [] scratch_;
+		scratchSize_ = count * channels_;
+		scratch_ = new Node[scratchSize_];
+	}
+	if (!readNodes(level, nfirst, count, scratch_))
+		return 0;
+
+	for (int b = 0; b < bins; b++)
+	{
+		long bstart = first + (long)((double)window * b / bins);
+		long bend = first + (long)((double)window * (b + 1) / bins);
+		if (bend <= bstart)
+			bend = bstart + 1;
+
+		long i0 = bstart / span - nfirst;
+		long i1 = (bend + span - 1) / span - nfirst;
+		if (i1 > count)
+			i1 = count;
+
+		float lo = scratch_[i0 * channels_ + channel].min;
+		float hi = scratch_[i0 * channels_ + channel].max;
+		double sum = 0;
+		long samples = 0;
+		for (long i = i0; i < i1; i++)
+		{
+			const Node& n = scratch_[i * channels_ + channel];
+			long covered = span;
+			if ((nfirst + i + 1) * span > length_)
+				covered = length_ - (nfirst + i) * span;
+			if (n.min < lo) lo = n.min;
+			if (n.max > hi) hi = n.max;
+			sum += (double)n.mean * covered;
+			samples += covered;
+		}
+
+		if (mins) mins[b] = lo;
+		if (maxs) maxs[b] = hi;
+		if (means) means[b] = (float)(sum / samples);
+	}
+	return bins;
+}
+
+/** Close the pyramid
+ *
+ *              Flushes the partial nodes bottom-up so that they cascade
+ *              into the levels above, then writes the header.
+ */
+void TracePyramid::close()
+{
+	if (writing_)
+	{
+		for (int k = 1; k < levels_; k++)
+		{
+			if (partialChildren_[k] == 0)
+				continue;
+			Node done[LOD_MAX_CHANNELS];
+			long covered = partialSamples_[k];
+			finish(k, done);
+			partialChildren_[k] = 0;
+			partialSamples_[k] = 0;
+			push(k, done, covered);
+		}
+
+		char path[280];
+		_snprintf(path, sizeof(path) - 1, "%s.lod", base_);
+		path[sizeof(path) - 1] = 0;
+		FILE* header = fopen(path, "w");
+		if (header != 0)
+		{
+			fprintf(header, "LOD %d %d %d %ld\n", channels_, fanout_, levels_, length_);
+			for (int k = 0; k < levels_; k++)
+				fprintf(header, "%ld\n", written_[k]);
+			fclose(header);
+		}
+		writing_ = false;
+	}
+
+	for (int k = 0; k < LOD_MAX_LEVELS; k++)
+	{
+		if (files_[k] != 0)
+			fclose(files_[k]);
+		files_[k] = 0;
+		written_[k] = 0;
+		partialChildren_[k] = 0;
+		partialSamples_[k] = 0;
+	}
+	length_ = 0;
+}
@@ -0,0 +1,158 @@
+/** Level of detail trace for long runs
+ *
+ *           \class  TracePyramid
+ *
+ *                   Keeps a min/max/mean pyramid of every recorded
+ *                   channel while the simulation runs, so that any
+ *                   time window of a 10^8 step run can be plotted at
+ *                   screen resolution without loading every sample.\n
+ *
+ *                   Level \b k holds one node per \f$F^k\f$ samples
+ *                   (F = fanout), level 0 being the raw samples.
+ *                   Every level is streamed to its own file
+ *                   <base>.lod<k> as soon as a node is complete and
+ *                   <base>.lod keeps the header, so only one partial
+ *                   node per level stays in memory.\n
+ *
+ *                   \b fanout (default) = 8 \n
+ *                   \b levels (default) = 10 \n
+ *
+ *                   Appending a sample touches level 0 only, except
+ *                   every F-th sample that also closes a node one level
+ *                   up: amortised \f$1 + 1/F + 1/F^2 ... \f$ node
+ *                   updates per sample.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef TracePyramid_h_
+#define TracePyramid_h_
+
+// =====================================================================================
+// System Includes
+// =====================================================================================
+
+#include <stdio.h>
+
+#define LOD_MAX_CHANNELS 16
+#define LOD_MAX_LEVELS   16
+
+// =====================================================================================
+// =====================================================================================
+class TracePyramid
+{
+
+  public:
+
+    // ====================  LIFECYCLE   =========================================
+
+    /*! Constructor channels,fanout,levels, the levels are capped so that
+        the widest node span fanout^(levels-1) fits a long */
+    TracePyramid(int channels=1, int fanout=8, int levels=10);
+    ~TracePyramid();
+
+    // ====================  OPERATIONS  =========================================
+
+    /** Create a new pyramid
+     *
+     *              Opens <base>.lod and the level files for writing.
+     *
+     *      @param  base const char* - Path of the trace without extension
+     *     @return  true if all the files could be created
+     */
+    bool create(const char* base);
+
+    /** Open an existing pyramid
+     *
+     *              Reads the header written by close() and opens the
+     *              level files for querying only.
+     *
+     *      @param  base const char* - Path of the trace without extension
+     *     @return  true if the header is valid
+     */
+    bool open(const char* base);
+
+    /** Append one sample
+     *
+     *      @param  sample const float* - One value per channel
+     */
+    void append(const float* sample);
+
+    /** Read a window at screen resolution
+     *
+     *              Picks the coarsest level whose nodes are not wider
+     *              than one bin and reduces the nodes of
+     *              [first,last) into \b bins columns.
+     *
+     *      @param  channel int - The channel index
+     *      @param  first long - First sample of the window
+     *      @param  last long - One past the last sample
+     *      @param  bins int - Number of output columns
+     *      @param  mins,maxs,means float* - bins values each (may be 0)
+     *     @return  the number of bins filled, 0 once closed
+     */
+    int query(int channel, long first, long last, int bins,
+              float* mins, float* maxs, float* means);
+
+    /** Close the pyramid
+     *
+     *              Flushes the partial nodes of every level and writes
+     *              the header. Called by the destructor too; the
+     *              pyramid is empty afterwards until open() or create().
+     */
+    void close();
+
+    // ====================  INQUIRY     =========================================
+
+    long getLength() {return length_;};
+    int getChannels() {return channels_;};
+    int getLevels() {return levels_;};
+
+  private:
+
+    /*! One summary node of one channel */
+    struct Node
+    {
+      float min;
+      float max;
+      float mean;
+    };
+
+    void push(int level, const Node* nodes, long samples);
+    void finish(int level, Node* out);
+    static int maxLevels(int fanout, int levels);
+    long nodeSpan(int level);
+    long nodeCount(int level);
+    void tail(int level, Node* out);
+    bool readNodes(int level, long first, long count, Node* out);
+
+    int  channels_;
+    int  fanout_;
+    int  levels_;
+    bool writing_;
+
+    /*! Samples appended so far */
+    long length_;
+
+    /*! Complete nodes written to each level file */
+    long written_[LOD_MAX_LEVELS];
+
+    /*! The node being accumulated on each level */
+    Node   partial_[LOD_MAX_LEVELS][LOD_MAX_CHANNELS];
+    double partialSum_[LOD_MAX_LEVELS][LOD_MAX_CHANNELS];
+    /*! Children and samples merged into the partial node */
+    int    partialChildren_[LOD_MAX_LEVELS];
+    long   partialSamples_[LOD_MAX_LEVELS];
+
+    char  base_[260];
+    FILE* files_[LOD_MAX_LEVELS];
+
+    /*! Scratch buffer for query() */
+    Node* scratch_;
+    long  scratchSize_;
+};
+
+#endif
@@ -41,9 +41,8 @@
 // =====================================================================================
 
 #include "Uico.h"
-
-
-#define max(a,b) (((a) > (b)) ? (a) : (b))
+#include "SharedWeights.h"
+#include <emmintrin.h>
 
 // =====================================================================================
 // Constructor and Destructor
@@ -57,7 +56,7 @@
  *      @param  q float - The quality.
  *
  */
-Uico::Uico(float f, float q)
+Uico::Uico(float f, float q) : UicoCore<float, double>(f, q, 1.0f, 0.0f)
 {
 	//debug
 	sumpos=0.0;
@@ -65,103 +64,33 @@ Uico::Uico(float f, float q)
 
 	/* the energy of the robot is 0 */
 	energy=0;
-	left_bump=0;
-	right_bump=0;
-	bias=0.0;
-    /*! x0, x1 signals: not filtered */
-    distal=0.0;
-    proximal=0.0;
-    /*! u0,u1 signals: filtered */
-    u0=0.0;
-	u1=0.0;
-
-	/*! The learning rate */
-    learningRate_=1.0;
-
-    /*! The reflex input */
-   reflex_=0.0;
-
-    /*! A switch for (no) learning */
-   noLearning_=false;
-
-   /*! True if normalizing bursts */
-   burst_=false;
-
-    /*! A switch for normalizing */
-    normalize_=true;
-
-		/*! Filtered response to antennas */
-	ul=0.0;
-	ur=0.0;
-    /*! Set the coefficients of the IIR filter associated to antennas*/
-	delay_coeff_[0]=-1.05;
-	delay_coeff_[1]=0.2750;
 
 	d_thresh=100;
-    setFQ(f,q);
 
-
-	synaptic_weights[0]=-0.1;
-	synaptic_weights[1]=0.1;
-	synaptic_weights[2]=-0.1;
-	synaptic_weights[3]=0.1;
-	reset();
+	/*! Private weights */
+	shared_=0;
+	sharedEvery_=0;
+	sharedTicks_=0;
+	sharedPending_[0]=0;
+	sharedPending_[1]=0;
+	sharedRetries_=0;
 }
 
 
-// =====================================================================================
-// =====================================================================================
-
-/** Initialization
- *
- *              Initialization of the \b denomiator_ needed for the
- *              calculation of the filter.
+/** Destructor
  *
- *      @param  f float - The frequency
- *      @param  q float - The quality
- *     @return   -
- *
- *    @remarks  The quality should be bigger than 0.51
+ *              Detaches from the shared weights, so that the deltas
+ *              still buffered in merge mode are not lost.
  */
-void Uico::setFQ(float f, float q)
+Uico::~Uico()
 {
-  // If Q is ok
-  if (q > 0)
-  {
-
-    double fTimesPi = f * PI * 2.0;
-    double e = fTimesPi / (2.0 * q);
-	printf("ftimes %f e %f \n",fTimesPi,e);
-    // If root is ok
-    if ((fTimesPi * fTimesPi - e * e) > 0)
-    {
-
-      float w = sqrt(fTimesPi * fTimesPi - e * e);
-      denominator_x0_[0] = -2.0 * exp(-e) * cos(w);
-      denominator_x0_[1] = exp(-2.0 * e);
-      denominator_x1_[0] = -2.0 * exp(-e) * cos(w);
-      denominator_x1_[1] = exp(-2.0 * e);
-		if(normalize_==true)
-      	{
-		calcNorm(LEFT_SYN);
-		calcNorm(RIGHT_SYN);
-		}
-		printf("e %f w %f \n",e,w);
-    }
-    // If root is bad
-    else
-    {
-		err=1;
-
-    }
-  }
-  // If Q is bad
-  else
-  {
-		err=2;
-  }
+	setSharedWeights(0);
 }
 
+
+// =====================================================================================
+// =====================================================================================
+
 /** Calibrate the robot and sensors
  *
  *              Calibrate bottom QTR sensors
@@ -179,46 +108,6 @@ void Uico::init(int left_port, int right_port)
 }
 
 
-/** Calculation of the normalizing factor.
- *
- *              Calculation of the normalizing factor.
- *
- *     @return   -
- *
- *    @remarks  The 'search' for the maximum is limited to 200. This
- *              can cause trouble if the frequency is to low.
- */
-void Uico::calcNorm(int index)
-{
-  norm_ = 1.;
-  // Reset of buffer
-	reset();
-  // Calculation of new norm
-  float nnorm = 0;
-  for (int i = 0; i < 1000; i++)
-  {
-    if(burst_)
-    {  
-	  	proximal=1;
-      	filterBP();
-	}
-    else
-    {
-	     proximal=(i == 5) ? 1 : 0;
-	     filterBP();
-    }
-
-    nnorm = max(nnorm, u0);
-  }
-  nextoutput_[index] = 0;
-
-  if (nnorm != 0)
-    norm_ = nnorm;
-
-  // Reset of buffer
-  reset();
-}
-
 /** Read sensors or synapses
  *
  *             Calculation of the next value according to the filter
@@ -251,163 +140,198 @@ void Uico::readSensors(int left,int right)
 }
 
 
-/** Calculation of the next value
+/** Calculation of the next output.
  *
- *             Calculation of the next value according to the filter
- *             equations.
+ *              Iterates all connected synapses and calculates the \b
+ *              nextoutput_ according to the ICO rule (UicoCore::update),
+ *              reading and publishing the shared weights around it.
  *
- *      @param  in float - The new value.
  *     @return   -
- *
- *    @remarks   -
  */
-void Uico::filterBP()
+void Uico::calculate()
 {
-  u0 = proximal- denominator_x0_[0] * buffer_x0_[0]- denominator_x0_[1] * buffer_x0_[1];
-
-  buffer_x0_[1] = buffer_x0_[0];
-  buffer_x0_[0] = proximal;
-
-  u1 = distal-denominator_x1_[0] * buffer_x1_[0]- denominator_x1_[1] * buffer_x1_[1];
-
-  buffer_x1_[1] = buffer_x1_[0];
-  buffer_x1_[0] = distal;
-
-  if (normalize_)
-  {
-    u0 /= norm_;
-    u1 /= norm_;
-  }
+	/*! compute the next output */
+	if (shared_ && sharedEvery_ == 0)
+		readShared();
 
+	/*! decrease the energy of the robot */
+	 energy-=1;
 
+  float dw;
+  if (update(dw) && shared_)
+    learnShared(dw);
 }
 
-void Uico::avoid(float left,float right)
+bool Uico::setFlushToZero(bool on)
 {
-	
-  ul = buffer_left_[1] - delay_coeff_[0]*buffer_out_left_[0]-delay_coeff_[1]*buffer_out_left_[1];
- 
-  buffer_out_left_[1] = buffer_out_left_[0];
-  buffer_out_left_[0] = ul;
-  
-  buffer_left_[1] = buffer_left_[0];
-  buffer_left_[0] = left;
-  
-  ur = buffer_right_[1] - delay_coeff_[0]*buffer_out_right_[0]-delay_coeff_[1]*buffer_out_right_[1];
- 
-  buffer_out_right_[1] = buffer_out_right_[0];
-  buffer_out_right_[0] = ur;
-  
-  buffer_right_[1] = buffer_right_[0];
-  buffer_right_[0] = right;
+  /* MXCSR bit 15 = flush to zero, bit 6 = denormals are zero */
+  unsigned int csr = _mm_getcsr();
+  _mm_setcsr(on ? (csr | 0x8040) : (csr & ~0x8040u));
+  return (csr & 0x8040) == 0x8040;
+}
 
+/*! flush() on the non zero lanes of a packed result */
+__m128 Uico::flushLanes(__m128 v, int stage)
+{
+  __m128 small = _mm_and_ps(_mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), v), _mm_set1_ps(denormalThreshold_)),
+                            _mm_cmpneq_ps(v, _mm_setzero_ps()));
+  int mask = _mm_movemask_ps(small);
+  if (mask == 0)
+    return v;
+  denormals_[stage] += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+  return denormalSafe_ ? _mm_andnot_ps(small, v) : v;
 }
 
-/** Calculation of the next output.
+/** Shared-weight mode
  *
- *              Iterates all connected synapses and calculates the \b
- *              nextoutput_ according to the ICO rule.
+ *              Attaching takes a snapshot of the shared set; detaching
+ *              merges what is still buffered and keeps the last
+ *              weights as the private ones.
  *
+ *      @param  shared SharedWeights* - The shared set, 0 to detach
+ *      @param  mergeEvery int - Ticks between merges, 0 = every tick
  *     @return   -
- *
- *    @remarks  The flags are: \n
- *              \b 0 <=> Reflex input (will not be learned) \n
- *              \b 1 <=> Predictive input (will be learned)
  */
-void Uico::calculate()
+void Uico::setSharedWeights(SharedWeights* shared, int mergeEvery)
 {
-  float nextreflex =u0;
-
-	/*! update delay lines for the contact sensors */
-  	delay(delay_size,delay_left_bump);   
-	delay(delay_size,delay_right_bump); 
-
-	/*! push the last contact event */
-	delay_left_bump[0]=left_bump;
-	delay_right_bump[0]=right_bump;
-	/*! weight the actual reflex with the number of times the sensor was active */
-	unsigned int short wleft=sum_delay(delay_size,delay_left_bump)*left_bump;
-	unsigned int short wright=sum_delay(delay_size,delay_left_bump)*right_bump;
-	/*! compute the next output */
-    float pre_LEFT= synaptic_weights[DISTAL_L]*u1+synaptic_weights[PROXIMAL_L]*u0-wleft;
-    float pre_RIGHT= synaptic_weights[DISTAL_R]*u1+synaptic_weights[PROXIMAL_R]*u0-wright;
-
-	/*! decrease the energy of the robot */
-	 energy-=1;
+  mergeShared();
+  shared_ = shared;
+  sharedEvery_ = mergeEvery < 0 ? 0 : mergeEvery;
+  sharedTicks_ = 0;
+  if (shared_)
+    readShared();
+}
 
-	// And now the learning part of the weights ...
-  if(noLearning_)
+void Uico::mergeShared()
+{
+  if (!shared_)
     return;
-
-  // Learn and update the distal synaptic weights
-  float derivReflex = nextreflex - reflex_;
-
-
-  synaptic_weights[DISTAL_L]-=learningRate_ * derivReflex * u1;
-  synaptic_weights[DISTAL_R]+=learningRate_ * derivReflex * u1;
-
-  reflex_ = nextreflex;
-
-  nextoutput_[LEFT_SYN]=getSigmValue(pre_LEFT+bias);
-  nextoutput_[RIGHT_SYN]=getSigmValue(pre_RIGHT+bias);
-
-
+  sharedRetries_ += shared_->add(DISTAL_L, sharedPending_[0]);
+  sharedRetries_ += shared_->add(DISTAL_R, sharedPending_[1]);
+  sharedPending_[0] = 0;
+  sharedPending_[1] = 0;
+  readShared();
 }
 
-signed char Uico::getSigmValue(float value){
-	// the sigma is shaped using a correction factor /100 + 6
-	float decay=(max_pwr_motor/100)+6;
-	return (max_pwr_motor/(1+exp(-value/decay)));
+void Uico::readShared()
+{
+  shared_->read(synaptic_weights);
 }
 
+/*! Publish the delta of one tick, now or at the next merge */
+void Uico::learnShared(float dw)
+{
+  if (sharedEvery_ == 0)
+  {
+    sharedRetries_ += shared_->add(DISTAL_L, -dw);
+    sharedRetries_ += shared_->add(DISTAL_R, dw);
+    return;
+  }
+  sharedPending_[0] -= dw;
+  sharedPending_[1] += dw;
+  if (++sharedTicks_ >= sharedEvery_)
+  {
+    sharedTicks_ = 0;
+    mergeShared();
+  }
+}
 
-/** Reseting of the neuron.
+/** Fused tick
  *
- *             Reseting of the neuron.
+ *             filterBP(), avoid() and calculate() in one pass on 128-bit
+ *             lanes: [u0 u1] in doubles like the denominators, [ul ur]
+ *             and [pre_LEFT pre_RIGHT] in floats.
  *
  *     @return   -
  *
- *    @remarks   -
+ *    @remarks   The operation order is the one of the scalar methods so
+ *               the two paths can be mixed on the same controller. The
+ *               results match them bit for bit only when they are
+ *               compiled to SSE2 too (x64, /arch:SSE2), x87 keeps wider
+ *               intermediates.
  */
-void Uico::reset()
+void Uico::step(int prox, int dist, float left, float right,
+                unsigned short lbump, unsigned short rbump)
 {
+  proximal = prox;
+  distal = dist;
+  left_bump = lbump;
+  right_bump = rbump;
+
+  // Resonators: lane 0 = proximal/u0, lane 1 = distal/u1
+  float hx0 = buffer_x0_[0], hx1 = buffer_x1_[0];
+  __m128d x  = _mm_setr_pd(prox, dist);
+  __m128d h0 = _mm_setr_pd(hx0, hx1);
+  __m128d h1 = _mm_setr_pd(buffer_x0_[1], buffer_x1_[1]);
+  __m128d d0 = _mm_setr_pd(denominator_x0_[0], denominator_x1_[0]);
+  __m128d d1 = _mm_setr_pd(denominator_x0_[1], denominator_x1_[1]);
+  __m128 u = _mm_cvtpd_ps(_mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(d0, h0)), _mm_mul_pd(d1, h1)));
+  if (normalize_)
+    u = _mm_div_ps(u, _mm_set1_ps(norm_));
+  u = flushLanes(u, STAGE_FILTER);
+
+  buffer_x0_[1] = hx0;
+  buffer_x1_[1] = hx1;
+  buffer_x0_[0] = (float)prox;
+  buffer_x1_[0] = (float)dist;
+
+  // Avoidance: lane 0 = left, lane 1 = right
+  float ol = buffer_out_left_[0], orr = buffer_out_right_[0];
+  __m128 in1 = _mm_setr_ps(buffer_left_[1], buffer_right_[1], 0, 0);
+  __m128 o0  = _mm_setr_ps(ol, orr, 0, 0);
+  __m128 o1  = _mm_setr_ps(buffer_out_left_[1], buffer_out_right_[1], 0, 0);
+  __m128 av = _mm_sub_ps(_mm_sub_ps(in1, _mm_mul_ps(_mm_set1_ps(delay_coeff_[0]), o0)),
+                         _mm_mul_ps(_mm_set1_ps(delay_coeff_[1]), o1));
+  av = flushLanes(av, STAGE_AVOID);
+
+  ul = _mm_cvtss_f32(av);
+  ur = _mm_cvtss_f32(_mm_shuffle_ps(av, av, _MM_SHUFFLE(1, 1, 1, 1)));
+  buffer_out_left_[1] = ol;
+  buffer_out_right_[1] = orr;
+  buffer_out_left_[0] = ul;
+  buffer_out_right_[0] = ur;
+  buffer_left_[1] = buffer_left_[0];
+  buffer_right_[1] = buffer_right_[0];
+  buffer_left_[0] = left;
+  buffer_right_[0] = right;
 
-		
-	for(int k=0;k<2;k++)
-	{
-	 buffer_x0_[k] = 0;
-	 buffer_x1_[k] = 0;
-	 
-	 buffer_left_[k]=0;
-	 buffer_right_[k]=0;
+  // Learning: lanes follow synaptic_weights [DL DR PL PR]
+  u0 = _mm_cvtss_f32(u);
+  u1 = _mm_cvtss_f32(_mm_shuffle_ps(u, u, _MM_SHUFFLE(1, 1, 1, 1)));
+  float nextreflex = u0;
 
-	 buffer_out_left_[k]=0;
-	 buffer_out_right_[k]=0;		
-		
-	}
+  // Both reflexes are weighted with the left line
+  unsigned int short active=pushBumps();
+  unsigned int short wleft=active*left_bump;
+  unsigned int short wright=active*right_bump;
 
-	
-  nextoutput_[LEFT_SYN] = 0;
-  nextoutput_[RIGHT_SYN] = 0;
-
-   for (int i=0; i<delay_size; i++)               /* reverse-order updating */
-   {
-	   delay_left_bump[i]=0;
-		delay_right_bump[i]=0;
-   }
-}
+  if (shared_ && sharedEvery_ == 0)
+    readShared();
+  __m128 w = _mm_loadu_ps(synaptic_weights);
+  __m128 prod = _mm_mul_ps(w, _mm_shuffle_ps(u, u, _MM_SHUFFLE(0, 0, 1, 1)));
+  __m128 pre = _mm_sub_ps(_mm_add_ps(prod, _mm_movehl_ps(prod, prod)),
+                          _mm_setr_ps((float)wleft, (float)wright, 0, 0));
 
+  energy-=1;
 
-void Uico::delay(int D,unsigned short int* w)            /* \(w[0]\) = input, \(w[D]\) = output */
-{
-       for (int i=D; i>=1; i--)               /* reverse-order updating */
-              w[i] = w[i-1];
+  if(noLearning_)
+    return;
+
+  float derivReflex = nextreflex - reflex_;
+  float dw = flush(learningRate_ * derivReflex * u1, STAGE_LEARN);
+  _mm_storeu_ps(synaptic_weights, _mm_add_ps(w, _mm_setr_ps(-dw, dw, 0, 0)));
+  if (shared_)
+    learnShared(dw);
+
+  reflex_ = nextreflex;
+
+  // The sigmoid stays on the scalar exp() of sigmoid(), a vector
+  // exp would not truncate to the same motor values
+  pre = _mm_add_ps(pre, _mm_set1_ps(bias));
+  nextoutput_[LEFT_SYN]=sigmoid(_mm_cvtss_f32(pre));
+  nextoutput_[RIGHT_SYN]=sigmoid(_mm_cvtss_f32(_mm_shuffle_ps(pre, pre, _MM_SHUFFLE(1, 1, 1, 1))));
 }
 
-unsigned short int Uico::sum_delay(int D,unsigned short int* w)            
-{
-	unsigned short int sum=0;
-       for (int i=0; i<D; i++)               /* reverse-order updating */
-              sum+=w[i];
-	   return sum/D;
+signed char Uico::getSigmValue(float value){
+	return sigmoid(value);
 }
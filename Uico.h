@@ -54,64 +54,29 @@
 
 
 #include "stdafx.h"
-
-
-#define LEFT_SYN  0
-#define RIGHT_SYN 1
-
-#define DISTAL_L  0
-#define DISTAL_R  1
-
-#define PROXIMAL_L  2
-#define PROXIMAL_R  3
-
-//approximation of PI GREEK
-#define PI 3.14159265
-
-/*! The bias of the robot or inertia that drives him*/
-
-#define delay_size 10
+#include <xmmintrin.h>
+#include "UicoCore.h"
 
 // =====================================================================================
 // Forward class declarations
 // =====================================================================================
 
+class SharedWeights;
 
 // =====================================================================================
 // =====================================================================================
-class Uico
+class Uico : public UicoCore<float, double>
 {
 
   private:
     static float  DEF_F;
     static float  DEF_Q;
-	static const int max_pwr_motor=100;
 
-    /*! Synaptic weights x 4 connections 2 distal + 2 proximal*/
-    float synaptic_weights[4];
     int d_thresh,r_max;
-    unsigned short err;
     /*! the energy of the agent in this case the amount of food*/
 	unsigned short energy;
 
   public:
-    /*! x0, x1 signals: not filtered */
-    int distal;
-    int proximal;
-	float bias;
-	/*! left and right switch sensors for navigation */
-	unsigned short left_bump;
-	unsigned short right_bump;
-	unsigned short delay_left_bump[delay_size];
-	unsigned short delay_right_bump[delay_size];
-
-    /*! u0,u1 signals: filtered */
-    float u0;
-	float u1;
-
-	float ul;
-	float ur;
-
 	/*! Debug fields */
 	float sumpos;
 	float sumneg;
@@ -123,6 +88,9 @@ class Uico
     /*! Constructor f,q */
     Uico(float f=DEF_F, float q=DEF_Q);
 
+    /*! Merges the buffered shared-weight deltas */
+    ~Uico();
+
 
     // ====================  OPERATORS   =========================================
 
@@ -132,29 +100,15 @@ class Uico
 
 	void readSensors(int left,int right);
 
-    /** Calculation of the next value
-     *
-     *             Calculation of the next value according to the filter
-     *             equations.
-     *
-     *      @param  in float - The new value.
-     *
-     */
-    void filterBP();
-    void avoid(float left,float right);
     signed char getSigmValue(float value);
     
     float getDistalLeft(int k=1){return k*synaptic_weights[DISTAL_L];}
 	float getDistalRight(int k=1){return k*synaptic_weights[DISTAL_R];}
+	float getWeight(int i){return synaptic_weights[i];}
 	
-	void setProximal(float proximal){this->proximal=proximal;}
-	void setDistal(float distal){this->distal=distal;}
-	
-	signed char getLeftOutput(){return  nextoutput_[LEFT_SYN];}
-	signed char getRightOutput(){return nextoutput_[RIGHT_SYN];}
+	signed char getLeftOutput(){return  (signed char)nextoutput_[LEFT_SYN];}
+	signed char getRightOutput(){return (signed char)nextoutput_[RIGHT_SYN];}
 
-		float getU0(){return   u0;}
-		float getU1(){return   u1;}
     /** Calculation of the next value
      *
      *             Calculation of the next value according to the filter
@@ -165,86 +119,84 @@ class Uico
      */
     void calculate();
 
-    /** Reseting of the neuron.
+    /** Fused tick
+     *
+     *             Runs filterBP(), avoid() and calculate() for one tick
+     *             in a single pass: the u0/u1 resonators share one SSE2
+     *             double register, the left/right avoidance filters and
+     *             the left/right pre-synaptic sums share float
+     *             registers. Every state value is loaded and stored
+     *             once. Results are identical to the separate calls
+     *             when those are compiled to SSE2 as well (x64 or
+     *             /arch:SSE2, set in IcoTest.vcproj).
      *
-     *             Reseting of the neuron.
+     *      @param  proximal,distal int - The x0, x1 signals
+     *      @param  left,right float - The antenna inputs of avoid()
+     *      @param  lbump,rbump unsigned short - The contact switches
      *
      */
-    void reset();
+    void step(int proximal, int distal, float left, float right,
+              unsigned short lbump, unsigned short rbump);
 
-    /** Initialization
-     *
-     *              Initialization of the \b denomiator_ needed for the
-     *              calculation of the filter.
+    // ====================  ACCESS      =========================================
+
+	void setDistanceLimit(int d){d_thresh=d;};
+
+    /** Flush to zero and denormals are zero for the calling thread
      *
-     *      @param  f float - The frequency
-     *      @param  q float - The quality
+     *    @return   true if they were on before, to restore them
      *
-     *    @remarks  The quality should be bigger than 0.51
+     *    @remarks  Only affects SSE arithmetic: every thread that ticks
+     *              controllers has to call it. x87 code (the default
+     *              of 32 bit builds without /arch:SSE2) relies on the
+     *              threshold flush of setDenormalSafe() alone.
      */
-    void setFQ(float f, float q);
+    static bool setFlushToZero(bool on);
 
-    /** Calculation of the normalizing factor.
+    /** Shared-weight mode
      *
-     *              Calculation of the normalizing factor.
+     *              Learns into \b shared instead of the private
+     *              synaptic_weights. With mergeEvery = 0 every tick
+     *              reads a snapshot and adds its delta atomically;
+     *              otherwise the deltas are buffered and merged (and
+     *              the snapshot refreshed) every \b mergeEvery ticks.
      *
-     *    @remarks  The 'search' for the maximum is limited to 200. This
-     *              can cause trouble if the frequency is to low.
+     *      @param  shared SharedWeights* - The shared set, 0 to detach
+     *      @param  mergeEvery int - Ticks between merges
+     *
+     *    @remarks  The set has to outlive the controller, which merges
+     *              its buffered deltas when detached or destroyed.
+     *              Merge mode is the one that scales with cores: every
+     *              tick of mergeEvery = 0 does two compare and swaps on
+     *              the one cache line all the controllers share.
      */
-    void calcNorm(int i);
-
-    // ====================  ACCESS      =========================================
+    void setSharedWeights(SharedWeights* shared, int mergeEvery=0);
 
-
-    void setBurst(bool burst) {burst_ = burst; calcNorm(LEFT_SYN);calcNorm(RIGHT_SYN);};
-
-    void setNormalize(bool fnormalize) {normalize_ = fnormalize;};
-    bool getNormalize() {return normalize_;};
-	void setDistanceLimit(int d){d_thresh=d;};
+    /*! Merge the buffered deltas now, e.g. before detaching */
+    void mergeShared();
 
     // ====================  INQUIRY     =========================================
 
-  private:
-
-	void delay(int D,unsigned short int* w) ;
-	unsigned short int sum_delay(int D,unsigned short int* w); 
+    /*! Compare and swap retries of the shared-weight updates */
+    unsigned long getSharedRetries() {return sharedRetries_;};
 
-    /*! The pre-factor */
-    double  denominator_x0_[2];
-    double  denominator_x1_[2];
-        
-    /*! The output with history */
-    float  buffer_x0_[2];
-    float  buffer_x1_[2];
-    
-	/* An IIR filter for the avoidance response */
-	float  delay_coeff_[2];
-	float  buffer_left_[2];
-	float  buffer_right_[2];
-	float  buffer_out_left_[2];
-	float  buffer_out_right_[2];
-    
-
-    signed char nextoutput_[2];
-
-    /*! The normalizing factor */
-    float  norm_;
-
-    /*! True if normalizing bursts */
-    bool    burst_;
+  private:
 
-    /*! A switch for normalizing */
-    bool    normalize_;
+    /*! Not copyable: a copy would merge the buffered deltas twice */
+    Uico(const Uico&);
+    Uico& operator=(const Uico&);
 
-  protected:
-    /*! The learning rate */
-    float learningRate_;
+	__m128 flushLanes(__m128 v, int stage);
 
-    /*! The reflex input */
-    float reflex_;
+    /*! Shared-weight mode: the set, merge period, buffered distal deltas */
+    SharedWeights* shared_;
+    int     sharedEvery_;
+    int     sharedTicks_;
+    float   sharedPending_[2];
+    unsigned long sharedRetries_;
 
-    /*! A switch for (no) learning */
-    bool   noLearning_;
+    void readShared();
+    void learnShared(float dw);
 
 };
 
@@ -0,0 +1,534 @@
+/** Equations of the Ico controller
+ *
+ *           \class  UicoCore
+ *
+ *                   The resonators, the avoidance filter, the contact
+ *                   delay lines and the ICO learning rule, written once
+ *                   for two scalar types:\n
+ *                   \b Real holds the state and the weights, \b Wide
+ *                   the filter coefficients and the setFQ algebra.\n
+ *
+ *                   Uico is UicoCore<float, double>: it adds the fused
+ *                   step(), the shared weights and the signed char
+ *                   motor outputs. UicoSens is UicoCore<DualF, Dual>,
+ *                   which rounds where the float code rounds and so
+ *                   returns the weights of Uico with their derivatives.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef UicoCore_h_
+#define UicoCore_h_
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+
+#define LEFT_SYN  0
+#define RIGHT_SYN 1
+
+#define DISTAL_L  0
+#define DISTAL_R  1
+
+#define PROXIMAL_L  2
+#define PROXIMAL_R  3
+
+//approximation of PI GREEK
+#define PI 3.14159265
+
+/*! The bias of the robot or inertia that drives him*/
+
+#define delay_size 10
+
+/*! Default flush level of the denormal-safe mode, well above FLT_MIN */
+#define DENORMAL_THRESHOLD 1e-30f
+
+/*! Stages of the denormal counters */
+#define STAGE_FILTER 0
+#define STAGE_AVOID  1
+#define STAGE_LEARN  2
+#define STAGE_COUNT  3
+
+/*! The setFQ trace of the float controller */
+inline void traceFQ(const char* format, double a, double b)
+{
+  printf(format, a, b);
+}
+
+// =====================================================================================
+// =====================================================================================
+template <class Real, class Wide>
+class UicoCore
+{
+
+  protected:
+    static const int max_pwr_motor=100;
+
+    /*! Synaptic weights x 4 connections 2 distal + 2 proximal*/
+    Real synaptic_weights[4];
+    unsigned short err;
+
+  public:
+    /*! x0, x1 signals: not filtered */
+    int distal;
+    int proximal;
+    Real bias;
+    /*! left and right switch sensors for navigation */
+    unsigned short left_bump;
+    unsigned short right_bump;
+    /*! rings of the last delay_size switch values, newest at delayHead_ */
+    unsigned short delay_left_bump[delay_size];
+    unsigned short delay_right_bump[delay_size];
+
+    /*! u0,u1 signals: filtered */
+    Real u0;
+    Real u1;
+
+    /*! Filtered response to antennas */
+    Real ul;
+    Real ur;
+
+  public:
+
+    // ====================  LIFECYCLE   =========================================
+
+    /*! Constructor f,q,learning rate,bias */
+    UicoCore(Real f, Real q, Real rate, Real bias);
+
+    // ====================  OPERATIONS  =========================================
+
+    /** Calculation of the next value
+     *
+     *             Calculation of the next value according to the filter
+     *             equations.
+     *
+     */
+    void filterBP();
+    void avoid(Real left, Real right);
+
+    /*! The motor sigmoid, before the truncation of Uico */
+    Real sigmoid(Real value);
+
+    /** Reseting of the neuron.
+     *
+     *             Reseting of the neuron.
+     *
+     */
+    void reset();
+
+    /** Initialization
+     *
+     *              Initialization of the \b denomiator_ needed for the
+     *              calculation of the filter.
+     *
+     *      @param  f Real - The frequency
+     *      @param  q Real - The quality
+     *
+     *    @remarks  The quality should be bigger than 0.51
+     */
+    void setFQ(Real f, Real q);
+
+    /** Calculation of the normalizing factor.
+     *
+     *              Calculation of the normalizing factor.
+     *
+     *    @remarks  The 'search' for the maximum is limited to 200. This
+     *              can cause trouble if the frequency is to low.
+     */
+    void calcNorm(int index);
+
+    // ====================  ACCESS      =========================================
+
+    /*! 0 if the last setFQ accepted f and q, 1 bad root, 2 bad q */
+    unsigned short getError() {return err;};
+
+    void setProximal(float proximal){this->proximal=proximal;}
+    void setDistal(float distal){this->distal=distal;}
+
+    Real getU0(){return u0;}
+    Real getU1(){return u1;}
+
+    void setBurst(bool burst) {burst_ = burst; calcNorm(LEFT_SYN);calcNorm(RIGHT_SYN);};
+
+    void setNormalize(bool fnormalize) {normalize_ = fnormalize;};
+    bool getNormalize() {return normalize_;};
+    void setLearningRate(Real rate){learningRate_=rate;};
+    void setNoLearning(bool off) {noLearning_ = off;};
+
+    /** Denormal-safe mode
+     *
+     *              Between sparse pulses the avoidance IIR outputs and
+     *              the learning deltas decay through the subnormal
+     *              range, where x86 is many times slower. When safe,
+     *              u0/u1, ul/ur and the weight delta are flushed to 0
+     *              below \b threshold. Off, the counters keep counting
+     *              the true subnormals (threshold FLT_MIN).
+     *
+     *      @param  safe bool - Flush the state
+     *      @param  threshold float - The flush level
+     */
+    void setDenormalSafe(bool safe, float threshold=DENORMAL_THRESHOLD)
+    {
+      denormalSafe_ = safe;
+      denormalThreshold_ = safe ? threshold : FLT_MIN;
+    }
+    bool getDenormalSafe() {return denormalSafe_;};
+
+    // ====================  INQUIRY     =========================================
+
+    /*! Values of a stage that were subnormal, or flushed when safe */
+    unsigned long getDenormalCount(int stage) {return denormals_[stage];};
+    void clearDenormalCount() {for(int k=0;k<STAGE_COUNT;k++) denormals_[k]=0;};
+
+  protected:
+
+    /** Calculation of the next output.
+     *
+     *              The ICO rule of calculate(), without what the
+     *              derived class does around it.
+     *
+     *      @param  dw Real& - The distal weight delta of the tick
+     *     @return  false if learning is off (dw and the outputs are
+     *              left as they are)
+     */
+    bool update(Real& dw);
+
+    unsigned short pushBumps();
+
+    /*! Counts a value below the denormal threshold, zeroes it when safe */
+    Real flush(Real x, int stage)
+    {
+      if (x != Real(0) && fabs(x) < Real(denormalThreshold_))
+      {
+        denormals_[stage]++;
+        if (denormalSafe_)
+          return Real(0);
+      }
+      return x;
+    }
+
+    /*! Ring position and running sums of the delay lines */
+    int delayHead_;
+    unsigned int delaySum_[2];
+
+    /*! The pre-factor */
+    Wide  denominator_x0_[2];
+    Wide  denominator_x1_[2];
+
+    /*! The input history, x0 and x1 carry no derivative */
+    float  buffer_x0_[2];
+    float  buffer_x1_[2];
+
+    /* An IIR filter for the avoidance response */
+    Real  delay_coeff_[2];
+    Real  buffer_left_[2];
+    Real  buffer_right_[2];
+    Real  buffer_out_left_[2];
+    Real  buffer_out_right_[2];
+
+    /*! The motor outputs */
+    Real  nextoutput_[2];
+
+    /*! The normalizing factor */
+    Real  norm_;
+
+    /*! True if normalizing bursts */
+    bool    burst_;
+
+    /*! A switch for normalizing */
+    bool    normalize_;
+
+    /*! Denormal-safe mode, its flush level and the counters per stage */
+    bool    denormalSafe_;
+    float   denormalThreshold_;
+    unsigned long denormals_[STAGE_COUNT];
+
+    /*! The learning rate */
+    Real learningRate_;
+
+    /*! The reflex input */
+    Real reflex_;
+
+    /*! A switch for (no) learning */
+    bool   noLearning_;
+
+};
+
+// =====================================================================================
+// Constructor
+// =====================================================================================
+
+/** Constructor that sets frequency, quality, learning rate and bias.
+ *
+ *      @param  f Real - The frequency.
+ *      @param  q Real - The quality.
+ *      @param  rate Real - The learning rate.
+ *      @param  bias Real - The motor bias.
+ *
+ */
+template <class Real, class Wide>
+UicoCore<Real, Wide>::UicoCore(Real f, Real q, Real rate, Real bias)
+{
+	left_bump=0;
+	right_bump=0;
+	this->bias=bias;
+    /*! x0, x1 signals: not filtered */
+    distal=0;
+    proximal=0;
+    /*! u0,u1 signals: filtered */
+    u0=Real(0);
+	u1=Real(0);
+
+    learningRate_=rate;
+    reflex_=Real(0);
+    noLearning_=false;
+    burst_=false;
+    normalize_=true;
+    norm_=Real(1);
+
+	/*! Filtered response to antennas */
+	ul=Real(0);
+	ur=Real(0);
+    /*! Set the coefficients of the IIR filter associated to antennas*/
+	delay_coeff_[0]=Real(-1.05);
+	delay_coeff_[1]=Real(0.2750);
+
+	/*! Count the subnormals, flush nothing */
+	denormalSafe_=false;
+	denormalThreshold_=FLT_MIN;
+	clearDenormalCount();
+
+    setFQ(f,q);
+
+	synaptic_weights[0]=Real(-0.1);
+	synaptic_weights[1]=Real(0.1);
+	synaptic_weights[2]=Real(-0.1);
+	synaptic_weights[3]=Real(0.1);
+	reset();
+	clearDenormalCount();
+}
+
+// =====================================================================================
+// =====================================================================================
+
+template <class Real, class Wide>
+void UicoCore<Real, Wide>::setFQ(Real f, Real q)
+{
+  err=0;
+  // If Q is ok
+  if (q > Real(0))
+  {
+
+    Wide fTimesPi = Wide(f) * Wide(PI) * Wide(2.0);
+    Wide e = fTimesPi / (Wide(2.0) * Wide(q));
+#ifndef ICO_LIB
+	traceFQ("ftimes %f e %f \n",fTimesPi,e);
+#endif
+    Wide root = fTimesPi * fTimesPi - e * e;
+    // If root is ok
+    if (root > Wide(0))
+    {
+
+      Real w = Real(sqrt(root));
+      denominator_x0_[0] = Wide(-2.0) * exp(-e) * Wide(cos(w));
+      denominator_x0_[1] = exp(Wide(-2.0) * e);
+      denominator_x1_[0] = denominator_x0_[0];
+      denominator_x1_[1] = denominator_x0_[1];
+		if(normalize_==true)
+      	{
+		calcNorm(LEFT_SYN);
+		calcNorm(RIGHT_SYN);
+		}
+#ifndef ICO_LIB
+		traceFQ("e %f w %f \n",e,w);
+#endif
+    }
+    // If root is bad
+    else
+    {
+		err=1;
+
+    }
+  }
+  // If Q is bad
+  else
+  {
+		err=2;
+  }
+}
+
+/**
+ *    @remarks  The derivative of the maximum is the derivative of the
+ *              sample that attains it.
+ */
+template <class Real, class Wide>
+void UicoCore<Real, Wide>::calcNorm(int index)
+{
+  norm_ = Real(1);
+  // Reset of buffer
+	reset();
+  // Calculation of new norm
+  Real nnorm = Real(0);
+  for (int i = 0; i < 1000; i++)
+  {
+    if(burst_)
+	  	proximal=1;
+    else
+	     proximal=(i == 5) ? 1 : 0;
+    filterBP();
+
+    if (u0 > nnorm)
+      nnorm = u0;
+  }
+  nextoutput_[index] = Real(0);
+
+  if (nnorm != Real(0))
+    norm_ = nnorm;
+
+  // Reset of buffer
+  reset();
+}
+
+template <class Real, class Wide>
+void UicoCore<Real, Wide>::filterBP()
+{
+  u0 = Real(Wide(proximal) - denominator_x0_[0] * Wide(buffer_x0_[0]) - denominator_x0_[1] * Wide(buffer_x0_[1]));
+
+  buffer_x0_[1] = buffer_x0_[0];
+  buffer_x0_[0] = proximal;
+
+  u1 = Real(Wide(distal) - denominator_x1_[0] * Wide(buffer_x1_[0]) - denominator_x1_[1] * Wide(buffer_x1_[1]));
+
+  buffer_x1_[1] = buffer_x1_[0];
+  buffer_x1_[0] = distal;
+
+  if (normalize_)
+  {
+    u0 /= norm_;
+    u1 /= norm_;
+  }
+
+  u0 = flush(u0, STAGE_FILTER);
+  u1 = flush(u1, STAGE_FILTER);
+}
+
+template <class Real, class Wide>
+void UicoCore<Real, Wide>::avoid(Real left, Real right)
+{
+
+  ul = buffer_left_[1] - delay_coeff_[0]*buffer_out_left_[0]-delay_coeff_[1]*buffer_out_left_[1];
+  ul = flush(ul, STAGE_AVOID);
+
+  buffer_out_left_[1] = buffer_out_left_[0];
+  buffer_out_left_[0] = ul;
+
+  buffer_left_[1] = buffer_left_[0];
+  buffer_left_[0] = left;
+
+  ur = buffer_right_[1] - delay_coeff_[0]*buffer_out_right_[0]-delay_coeff_[1]*buffer_out_right_[1];
+  ur = flush(ur, STAGE_AVOID);
+
+  buffer_out_right_[1] = buffer_out_right_[0];
+  buffer_out_right_[0] = ur;
+
+  buffer_right_[1] = buffer_right_[0];
+  buffer_right_[0] = right;
+
+}
+
+/** Push the contact switches into the delay lines
+ *
+ *             The lines are rings: the newest value overwrites the
+ *             oldest at \b delayHead_ and the running sums follow, so
+ *             no value is moved.
+ *
+ *     @return   the mean of the left line
+ */
+template <class Real, class Wide>
+inline unsigned short UicoCore<Real, Wide>::pushBumps()
+{
+	delayHead_ = (delayHead_ == 0) ? delay_size - 1 : delayHead_ - 1;
+	delaySum_[LEFT_SYN] += left_bump - delay_left_bump[delayHead_];
+	delaySum_[RIGHT_SYN] += right_bump - delay_right_bump[delayHead_];
+	delay_left_bump[delayHead_] = left_bump;
+	delay_right_bump[delayHead_] = right_bump;
+	return (unsigned short)delaySum_[LEFT_SYN] / delay_size;
+}
+
+/**
+ *    @remarks  The flags are: \n
+ *              \b 0 <=> Reflex input (will not be learned) \n
+ *              \b 1 <=> Predictive input (will be learned)
+ */
+template <class Real, class Wide>
+bool UicoCore<Real, Wide>::update(Real& dw)
+{
+  Real nextreflex =u0;
+
+	/*! push the last contact event into the delay lines */
+	unsigned int short active=pushBumps();
+	/*! weight the actual reflex with the number of times the sensor was active */
+	unsigned int short wleft=active*left_bump;
+	unsigned int short wright=active*right_bump;
+	/*! compute the next output */
+    Real pre_LEFT= synaptic_weights[DISTAL_L]*u1+synaptic_weights[PROXIMAL_L]*u0-Real(wleft);
+    Real pre_RIGHT= synaptic_weights[DISTAL_R]*u1+synaptic_weights[PROXIMAL_R]*u0-Real(wright);
+
+	// And now the learning part of the weights ...
+  if(noLearning_)
+    return false;
+
+  // Learn and update the distal synaptic weights
+  Real derivReflex = nextreflex - reflex_;
+  dw = flush(learningRate_ * derivReflex * u1, STAGE_LEARN);
+
+  synaptic_weights[DISTAL_L]-=dw;
+  synaptic_weights[DISTAL_R]+=dw;
+
+  reflex_ = nextreflex;
+
+  nextoutput_[LEFT_SYN]=sigmoid(pre_LEFT+bias);
+  nextoutput_[RIGHT_SYN]=sigmoid(pre_RIGHT+bias);
+  return true;
+}
+
+template <class Real, class Wide>
+Real UicoCore<Real, Wide>::sigmoid(Real value)
+{
+	// the sigma is shaped using a correction factor /100 + 6
+	Real decay=Real((max_pwr_motor/100)+6);
+	return Real(max_pwr_motor)/(Real(1)+exp(-value/decay));
+}
+
+template <class Real, class Wide>
+void UicoCore<Real, Wide>::reset()
+{
+	for(int k=0;k<2;k++)
+	{
+	 buffer_x0_[k] = 0;
+	 buffer_x1_[k] = 0;
+
+	 buffer_left_[k]=Real(0);
+	 buffer_right_[k]=Real(0);
+	 buffer_out_left_[k]=Real(0);
+	 buffer_out_right_[k]=Real(0);
+	}
+
+  nextoutput_[LEFT_SYN] = Real(0);
+  nextoutput_[RIGHT_SYN] = Real(0);
+
+   for (int i=0; i<delay_size; i++)
+   {
+	   delay_left_bump[i]=0;
+		delay_right_bump[i]=0;
+   }
+   delayHead_=0;
+   delaySum_[LEFT_SYN]=0;
+   delaySum_[RIGHT_SYN]=0;
+}
+
+#endif
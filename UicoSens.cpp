@@ -0,0 +1,37 @@
+/** Ico controller with parameter sensitivities
+ *
+ *           \class  UicoSens
+ *
+ *                   See UicoSens.h. The equations are the ones of
+ *                   UicoCore, shared with Uico.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+// =====================================================================================
+// Includes
+// =====================================================================================
+
+#include "stdafx.h"
+#include "UicoSens.h"
+
+// =====================================================================================
+// Constructor
+// =====================================================================================
+
+/** Constructor that seeds the four parameters.
+ *
+ *      @param  f float - The frequency.
+ *      @param  q float - The quality.
+ *      @param  rate float - The learning rate.
+ *      @param  bias float - The motor bias.
+ *
+ */
+UicoSens::UicoSens(float f, float q, float rate, float bias)
+  : UicoCore<DualF, Dual>(Dual::seed(f,DUAL_F),Dual::seed(q,DUAL_Q),
+                          Dual::seed(rate,DUAL_RATE),Dual::seed(bias,DUAL_BIAS))
+{
+}
@@ -0,0 +1,64 @@
+/** Ico controller with parameter sensitivities
+ *
+ *           \class  UicoSens
+ *
+ *                   The equations of Uico (UicoCore) evaluated on Dual
+ *                   numbers, so that a single run returns the synaptic
+ *                   weights together with their derivatives with
+ *                   respect to \b f, \b q, the learning rate and the
+ *                   bias.\n
+ *
+ *                   The state is DualF, rounded where Uico rounds its
+ *                   floats, so the weights are the ones of Uico bit for
+ *                   bit (SSE builds).\n
+ *
+ *                   The motor outputs are the continuous sigmoid: the
+ *                   truncation to signed char of Uico has no useful
+ *                   derivative. There is no shared-weight mode, whose
+ *                   weights depend on the other controllers.
+ *
+ *            \date  19/10/2026
+ *
+ *         \version  1.0
+ *
+ */
+
+#ifndef UicoSens_h_
+#define UicoSens_h_
+
+#include "Dual.h"
+#include "UicoCore.h"
+
+/*! setFQ of the Dual runs leaves no trace */
+inline void traceFQ(const char*, const Dual&, const Dual&) {}
+
+// =====================================================================================
+// =====================================================================================
+class UicoSens : public UicoCore<DualF, Dual>
+{
+
+  public:
+
+    // ====================  LIFECYCLE   =========================================
+
+    /** Constructor f,q,learning rate,bias
+     *
+     *              Every parameter is seeded with derivative 1 with
+     *              respect to itself.
+     */
+    UicoSens(float f, float q, float rate=1.0, float bias=0.0);
+
+    // ====================  OPERATIONS  =========================================
+
+    void calculate() {DualF dw; update(dw);};
+
+    // ====================  ACCESS      =========================================
+
+    Dual getWeight(int i){return synaptic_weights[i];}
+    Dual getDistalLeft(){return synaptic_weights[DISTAL_L];}
+    Dual getDistalRight(){return synaptic_weights[DISTAL_R];}
+    Dual getLeftOutput(){return nextoutput_[LEFT_SYN];}
+    Dual getRightOutput(){return nextoutput_[RIGHT_SYN];}
+};
+
+#endif
@@ -0,0 +1,41 @@
+function [mins,maxs,means] = loadlod(base,channel,first,last,bins)
+%LOADLOD read a window of a TracePyramid trace at screen resolution
+%   [mins,maxs,means] = loadlod('iconew',1,0,1e8,1000)
+%   channel is 1-based, [first,last) are 0-based sample indices.
+%   Channels written by IcoTest: u0 u1 ul ur wDL wDR outL outR
+h = fopen([base '.lod'],'r');
+hdr = fscanf(h,'LOD %d %d %d %d');
+written = fscanf(h,'%d');
+fclose(h);
+channels = hdr(1); fanout = hdr(2); levels = hdr(3); len = hdr(4);
+last = min(last,len);
+window = last-first;
+% coarsest level whose nodes are not wider than one bin
+level = 0;
+while level+1 < levels && fanout^(level+1)*bins <= window
+    level = level+1;
+end
+span = fanout^level;
+nfirst = floor(first/span);
+nlast = min(ceil(last/span),written(level+1));
+f = fopen(sprintf('%s.lod%d',base,level),'r');
+if level == 0
+    fseek(f,nfirst*channels*4,'bof');
+    raw = fread(f,[channels nlast-nfirst],'float32');
+    lo = raw(channel,:); hi = lo; mu = lo;
+else
+    fseek(f,nfirst*channels*12,'bof');
+    raw = fread(f,[3*channels nlast-nfirst],'float32');
+    lo = raw(3*channel-2,:); hi = raw(3*channel-1,:); mu = raw(3*channel,:);
+end
+fclose(f);
+mins = zeros(1,bins); maxs = mins; means = mins;
+for b = 0:bins-1
+    bs = first+floor(window*b/bins);
+    be = max(first+floor(window*(b+1)/bins),bs+1);
+    i = (floor(bs/span):ceil(be/span)-1)-nfirst+1;
+    i = i(i <= numel(lo));
+    mins(b+1) = min(lo(i));
+    maxs(b+1) = max(hi(i));
+    means(b+1) = mean(mu(i));
+end
@@ -11,5 +11,6 @@
 #include <tchar.h>
 #include <math.h>
 #include "Uico.h"
+#include "TracePyramid.h"
 
 // TODO: reference additional headers your program requires here